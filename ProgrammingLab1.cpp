@@ -1,160 +1,2340 @@
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <deque>
+#include <vector>
+#include <new>
+#include <type_traits>
+#include <map>
+#include <bitset>
+#include <limits>
+#include <cstdint>
+#include <climits>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <list>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
-// Class representing a person (a node in the linked list)
-class Person {
+// Links embedded in every element of a LinkedList
+template <class T>
+class ListHook {
+public:
+    T* next;  // Pointer to the next element in the list
+    T* prev;  // Pointer to the previous element in the list
+
+    ListHook() : next(nullptr), prev(nullptr) {}
+
+    // A copied or moved element is not linked anywhere yet
+    ListHook(const ListHook&) : next(nullptr), prev(nullptr) {}
+    ListHook& operator=(const ListHook&) { return *this; }
+};
+
+// Slab allocator handing out T-sized slots from contiguous chunks
+template <class T>
+class NodePool {
+private:
+    // A slot holds either a live T or a link to the next free slot
+    union Slot {
+        Slot* nextFree;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static const size_t SLOTS_PER_CHUNK = 1024; // Slots allocated at once
+
+    vector<Slot*> chunks;  // All chunks owned by the pool
+    Slot* freeList;        // Slots returned by deallocate, reused first
+    size_t usedInChunk;    // Slots handed out from the newest chunk
+    size_t chunkCapacity;  // Number of slots in the newest chunk
+
+public:
+    NodePool() : freeList(nullptr), usedInChunk(0), chunkCapacity(0) {}
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    // Release every chunk at once; live objects must be destroyed beforehand
+    ~NodePool() {
+        for (Slot* chunk : chunks) delete[] chunk;
+    }
+
+    // Get raw memory for one T
+    void* allocate() {
+        if (freeList != nullptr) {
+            Slot* slot = freeList;
+            freeList = slot->nextFree;
+            return slot;
+        }
+        if (usedInChunk == chunkCapacity) addChunk(SLOTS_PER_CHUNK);
+        return &chunks.back()[usedInChunk++];
+    }
+
+    // Make sure the next slots allocations come from one contiguous chunk
+    void reserve(size_t slots) {
+        if (chunkCapacity - usedInChunk < slots) addChunk(slots);
+    }
+
+    // Start handing out slots from a new chunk of the given size
+    void addChunk(size_t slots) {
+        chunks.push_back(new Slot[slots]);
+        usedInChunk = 0;
+        chunkCapacity = slots;
+    }
+
+    // Return memory of a destroyed T to the free list
+    void deallocate(void* memory) {
+        Slot* slot = static_cast<Slot*>(memory);
+        slot->nextFree = freeList;
+        freeList = slot;
+    }
+
+    // Number of chunks currently owned by the pool
+    size_t chunkCount() const { return chunks.size(); }
+};
+
+// How a LinkedList obtains memory for its elements
+enum class NodeAllocation {
+    Pool,  // Contiguous chunks from a NodePool
+    Heap   // A separate new/delete for every element
+};
+
+// Doubly linked list owning elements of type T, which derives from ListHook<T>.
+// Elements are constructed in place, so an element is never copied into the list.
+template <class T>
+class LinkedList {
+public:
+    // Forward iterator over the elements; Value is T or const T
+    template <class Value>
+    class Iterator {
+    private:
+        Value* element;  // Current element, nullptr at the end
+
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef typename remove_const<Value>::type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef Value* pointer;
+        typedef Value& reference;
+
+        explicit Iterator(Value* element = nullptr) : element(element) {}
+
+        // A mutable iterator converts to a const one
+        operator Iterator<const Value>() const { return Iterator<const Value>(element); }
+
+        Value& operator*() const { return *element; }
+        Value* operator->() const { return element; }
+        Iterator& operator++() { element = element->next; return *this; }
+        Iterator operator++(int) { Iterator old = *this; element = element->next; return old; }
+        bool operator==(const Iterator& other) const { return element == other.element; }
+        bool operator!=(const Iterator& other) const { return element != other.element; }
+    };
+
+    typedef Iterator<T> iterator;
+    typedef Iterator<const T> const_iterator;
+
+private:
+    T* head;       // Pointer to the first element of the list
+    T* tail;       // Pointer to the last element of the list
+    size_t count;  // Number of elements in the list
+    NodeAllocation allocation; // Where elements come from
+    NodePool<T> pool;          // Element storage when allocation is Pool
+
+    // Construct an element using the selected allocation mode
+    template <class... Args>
+    T* create(Args&&... args) {
+        if (allocation == NodeAllocation::Heap) return new T(std::forward<Args>(args)...);
+        return new (pool.allocate()) T(std::forward<Args>(args)...);
+    }
+
+    // Link an element between two neighbours (either may be null)
+    iterator link(T* before, T* after, T* element) {
+        element->prev = before;
+        element->next = after;
+        if (before != nullptr) before->next = element; else head = element;
+        if (after != nullptr) after->prev = element; else tail = element;
+        count++;
+        return iterator(element);
+    }
+
+public:
+    // Constructor initializes the list to be empty
+    explicit LinkedList(NodeAllocation allocation = NodeAllocation::Pool)
+        : head(nullptr), tail(nullptr), count(0), allocation(allocation) {}
+
+    // The list owns its elements, so it must not be copied
+    LinkedList(const LinkedList&) = delete;
+    LinkedList& operator=(const LinkedList&) = delete;
+
+    // Destructor to free memory of all elements
+    ~LinkedList() {
+        if (allocation == NodeAllocation::Pool) {
+            // The pool frees its chunks wholesale; only run destructors that do something
+            if (!is_trivially_destructible<T>::value) {
+                for (T* temp = head; temp != nullptr; temp = temp->next) temp->~T();
+            }
+            return;
+        }
+        while (head != nullptr) {
+            T* temp = head;
+            head = head->next;
+            delete temp;
+        }
+    }
+
+    // Construct an element at the beginning of the list
+    template <class... Args>
+    iterator emplace_front(Args&&... args) {
+        return link(nullptr, head, create(std::forward<Args>(args)...));
+    }
+
+    // Construct an element at the end of the list
+    template <class... Args>
+    iterator emplace_back(Args&&... args) {
+        return link(tail, nullptr, create(std::forward<Args>(args)...));
+    }
+
+    // Construct an element right after position
+    template <class... Args>
+    iterator emplace_after(iterator position, Args&&... args) {
+        return link(&*position, position->next, create(std::forward<Args>(args)...));
+    }
+
+    // Construct an element right before position
+    template <class... Args>
+    iterator emplace_before(iterator position, Args&&... args) {
+        return link(position->prev, &*position, create(std::forward<Args>(args)...));
+    }
+
+    // Move an element to the beginning or the end of the list
+    void push_front(T&& value) { emplace_front(std::move(value)); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    // Unlink and destroy one element
+    void erase(iterator position) {
+        T* element = &*position;
+        if (element->prev != nullptr) element->prev->next = element->next; else head = element->next;
+        if (element->next != nullptr) element->next->prev = element->prev; else tail = element->prev;
+        count--;
+
+        if (allocation == NodeAllocation::Heap) {
+            delete element;
+            return;
+        }
+        element->~T();
+        pool.deallocate(element);
+    }
+
+    // Prepare for adding elements; pooled elements then share one chunk
+    void reserve(size_t elements) {
+        if (allocation == NodeAllocation::Pool) pool.reserve(elements);
+    }
+
+    // Iterator to an element that is already in this list
+    iterator iterator_to(T& element) { return iterator(&element); }
+
+    iterator begin() { return iterator(head); }
+    iterator end() { return iterator(); }
+    const_iterator begin() const { return const_iterator(head); }
+    const_iterator end() const { return const_iterator(); }
+
+    T& front() { return *head; }
+    T& back() { return *tail; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Allocation mode chosen at construction
+    NodeAllocation allocationMode() const { return allocation; }
+};
+
+// Handle of a name stored in a NamePool
+typedef uint32_t NameId;
+
+// Stores every distinct name once and hands out small integer handles,
+// so equal names are compared by handle instead of character by character
+class NamePool {
+private:
+    deque<string> texts;                     // Text of every id (deque elements never move)
+    unordered_map<string_view, NameId> ids;  // Text -> id; keys view into texts
+    vector<NameId> freeIds;                  // Released ids, reused first
+
+public:
+    static const NameId NO_NAME = UINT32_MAX; // Returned by find for unknown names
+
+    // Handle of a name, or NO_NAME if it is not in the pool
+    NameId find(string_view text) const {
+        auto found = ids.find(text);
+        return found != ids.end() ? found->second : NO_NAME;
+    }
+
+    // Handle of a name, storing a copy of it the first time it is seen
+    NameId intern(string_view text) {
+        auto found = ids.find(text);
+        if (found != ids.end()) return found->second;
+
+        NameId id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+            texts[id].assign(text.data(), text.size());
+        }
+        else {
+            id = NameId(texts.size());
+            texts.emplace_back(text);
+        }
+        ids.emplace(string_view(texts[id]), id);
+        return id;
+    }
+
+    // Forget a name nobody uses any more; its id may be handed out again
+    void release(NameId id) {
+        ids.erase(string_view(texts[id]));
+        string().swap(texts[id]);
+        freeIds.push_back(id);
+    }
+
+    // Make room for up to count more names without rehashing
+    void reserve(size_t count) { ids.reserve(ids.size() + count); }
+
+    // Text of a name
+    const string& text(NameId id) const { return texts[id]; }
+
+    // Number of distinct names currently stored
+    size_t size() const { return ids.size(); }
+
+    // Upper bound on valid ids (released ones included)
+    size_t idLimit() const { return texts.size(); }
+
+    // Approximate heap memory used by the pool
+    size_t bytes() const {
+        size_t total = texts.size() * sizeof(string) + freeIds.capacity() * sizeof(NameId);
+        size_t inlineCapacity = string().capacity();
+        for (const string& text : texts) {
+            if (text.capacity() > inlineCapacity) total += text.capacity() + 1; // Not stored inline
+        }
+        // Hash node (next pointer, key, value, cached hash) plus one bucket pointer each
+        total += ids.size() * (sizeof(void*) + sizeof(string_view) + sizeof(NameId) + sizeof(size_t));
+        total += ids.bucket_count() * sizeof(void*);
+        return total;
+    }
+};
+
+// Class representing a person (a node in the linked list)
+class Person : public ListHook<Person> {
+public:
+    NameId name;       // Person's name, interned in the list's NamePool
+    int age;           // Person's age
+    double salary;     // Person's salary
+    Person* nextSameName;     // Next person with the same name (in list order)
+    Person* prevSameName;     // Previous person with the same name (in list order)
+    unsigned long long order; // Position label, strictly increasing from head to tail
+
+    // Constructor to initialize the person object
+    Person(NameId name, int age, double salary)
+        : name(name), age(age), salary(salary),
+          nextSameName(nullptr), prevSameName(nullptr), order(0) {}
+};
+
+// Ordered index over people by one numeric key (salary or age).
+// An indexable skip list: every link also stores how many entries it
+// skips, so range starts, ranks and top-N lookups take O(log n).
+// Entries with equal keys are ordered by node address.
+template <class Key>
+class OrderedIndex {
+private:
+    struct Node;
+
+    // Forward pointer plus the number of positions it advances
+    struct Link {
+        Node* next;
+        size_t width;
+    };
+
+    struct Node {
+        Key key;
+        const Person* person;
+        vector<Link> links;  // One link per level this node takes part in
+    };
+
+    static const int MAX_LEVEL = 24; // Enough for 4^24 entries with p = 1/4
+
+    Node head;       // Sentinel before the first entry, present on every level
+    size_t count;    // Number of entries
+    uint32_t seed;   // State of the level generator
+
+    // Entry order: by key, then by node address
+    static bool before(const Node* node, const Key& key, const Person* person) {
+        return node->key < key || (!(key < node->key) && less<const Person*>()(node->person, person));
+    }
+
+    // Each level is kept with probability 1/4
+    int randomLevel() {
+        int level = 1;
+        while (level < MAX_LEVEL) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            if ((seed & 3) != 0) break;
+            level++;
+        }
+        return level;
+    }
+
+    // Last node whose key is below key (the head if there is none)
+    const Node* lastBelow(const Key& key, size_t& position) const {
+        const Node* node = &head;
+        position = 0;
+        for (int i = MAX_LEVEL - 1; i >= 0; i--) {
+            while (node->links[i].next != nullptr && node->links[i].next->key < key) {
+                position += node->links[i].width;
+                node = node->links[i].next;
+            }
+        }
+        return node;
+    }
+
+    // Node at a 1-based position (0 is the head)
+    const Node* nodeAt(size_t position) const {
+        const Node* node = &head;
+        size_t reached = 0;
+        for (int i = MAX_LEVEL - 1; i >= 0; i--) {
+            while (node->links[i].next != nullptr && reached + node->links[i].width <= position) {
+                reached += node->links[i].width;
+                node = node->links[i].next;
+            }
+        }
+        return node;
+    }
+
+public:
+    OrderedIndex() : count(0), seed(2463534242u) {
+        head.person = nullptr;
+        head.links.assign(MAX_LEVEL, Link{nullptr, 1});
+    }
+
+    OrderedIndex(const OrderedIndex&) = delete;
+    OrderedIndex& operator=(const OrderedIndex&) = delete;
+
+    ~OrderedIndex() {
+        Node* node = head.links[0].next;
+        while (node != nullptr) {
+            Node* following = node->links[0].next;
+            delete node;
+            node = following;
+        }
+    }
+
+    // Add an entry for a person
+    void insert(const Key& key, const Person* person) {
+        Node* update[MAX_LEVEL];      // Last node before the new entry on each level
+        size_t positions[MAX_LEVEL];  // Position of update[i]
+        Node* node = &head;
+        size_t position = 0;
+        for (int i = MAX_LEVEL - 1; i >= 0; i--) {
+            while (node->links[i].next != nullptr && before(node->links[i].next, key, person)) {
+                position += node->links[i].width;
+                node = node->links[i].next;
+            }
+            update[i] = node;
+            positions[i] = position;
+        }
+
+        // The new entry lands at position + 1
+        Node* entry = new Node{key, person, vector<Link>(randomLevel())};
+        for (int i = 0; i < MAX_LEVEL; i++) {
+            Link& link = update[i]->links[i];
+            if (i < (int)entry->links.size()) {
+                entry->links[i].next = link.next;
+                entry->links[i].width = positions[i] + link.width - position;
+                link.next = entry;
+                link.width = position + 1 - positions[i];
+            }
+            else {
+                link.width++;  // Higher links now jump over one more entry
+            }
+        }
+        count++;
+    }
+
+    // Remove the entry for a person; key must be the one it was inserted with
+    void erase(const Key& key, const Person* person) {
+        Node* update[MAX_LEVEL];
+        Node* node = &head;
+        for (int i = MAX_LEVEL - 1; i >= 0; i--) {
+            while (node->links[i].next != nullptr && before(node->links[i].next, key, person)) {
+                node = node->links[i].next;
+            }
+            update[i] = node;
+        }
+
+        Node* entry = update[0]->links[0].next;
+        if (entry == nullptr || entry->person != person) return;
+
+        for (int i = 0; i < MAX_LEVEL; i++) {
+            Link& link = update[i]->links[i];
+            if (link.next == entry) {
+                link.width += entry->links[i].width - 1;
+                link.next = entry->links[i].next;
+            }
+            else {
+                link.width--;
+            }
+        }
+        delete entry;
+        count--;
+    }
+
+    size_t size() const { return count; }
+
+    // Number of entries with a key strictly below key
+    size_t rank(const Key& key) const {
+        size_t position;
+        lastBelow(key, position);
+        return position;
+    }
+
+    // Call visit(const Person&) for minKey <= key <= maxKey in ascending key order
+    template <class Visitor>
+    void forEachBetween(const Key& minKey, const Key& maxKey, Visitor visit) const {
+        size_t position;
+        const Node* node = lastBelow(minKey, position)->links[0].next;
+        while (node != nullptr && !(maxKey < node->key)) {
+            visit(*node->person);
+            node = node->links[0].next;
+        }
+    }
+
+    // The n entries with the largest keys, largest first
+    vector<const Person*> top(size_t n) const {
+        if (n > count) n = count;
+        vector<const Person*> result;
+        result.reserve(n);
+        for (const Node* node = nodeAt(count - n)->links[0].next; node != nullptr; node = node->links[0].next) {
+            result.push_back(node->person);
+        }
+        reverse(result.begin(), result.end());
+        return result;
+    }
+};
+
+// Class representing the linked list of people
+class PersonList {
+private:
+    // All people sharing one name, linked through nextSameName/prevSameName
+    struct NameChain {
+        Person* first;  // Earliest person with this name in list order
+        Person* last;   // Latest person with this name in list order
+    };
+
+    static const unsigned long long ORDER_GAP = 1ULL << 32; // Label distance for nodes added at the ends
+
+    LinkedList<Person> people;  // The people themselves, in list order
+    NamePool names;             // Every name used in the list, stored once
+    vector<NameChain> chains;   // Name id -> all people with that name
+    unique_ptr<OrderedIndex<double>> salaryIndex; // Optional index by salary
+    unique_ptr<OrderedIndex<int>> ageIndex;       // Optional index by age
+
+    // Make room for the label of a node that has none between its neighbours by
+    // spreading out the labels of a small neighbourhood (list order maintenance).
+    // The candidate range is the block of 2^bits labels around a neighbour's label;
+    // it doubles until it holds few enough nodes (at most 2^bits / 1.4^bits), and
+    // then those nodes are relabelled evenly. Dense regions are thus spread out before
+    // they fill up, which keeps insertion at O(log n) amortized.
+    void relabelAround(Person* node) {
+        const double DENSITY_BASE = 1.4;
+        unsigned long long base = node->prev != nullptr ? node->prev->order : node->next->order;
+        Person* first = node;
+        Person* last = node;
+        size_t count = 1;
+        double span = 1, allowance = 1;  // 2^bits and 1.4^bits
+        for (int bits = 1; bits <= 64; bits++) {
+            span *= 2;
+            allowance *= DENSITY_BASE;
+            unsigned long long mask = bits == 64 ? ULLONG_MAX : (1ULL << bits) - 1;
+            unsigned long long low = base & ~mask, high = base | mask;
+            while (first->prev != nullptr && first->prev->order >= low) { first = first->prev; count++; }
+            while (last->next != nullptr && last->next->order <= high) { last = last->next; count++; }
+            if (count * allowance > span && bits < 64) continue;
+
+            unsigned long long step = (high - low) / count;
+            unsigned long long label = low + step / 2;
+            for (Person* p = first; ; p = p->next) {
+                p->order = label;
+                label += step;
+                if (p == last) break;
+            }
+            return;
+        }
+    }
+
+    // Give an already linked node a label between its neighbours
+    void assignOrder(Person* node) {
+        Person* before = node->prev;
+        Person* after = node->next;
+
+        if (before == nullptr && after == nullptr) {
+            node->order = 1ULL << 63;
+        }
+        else if (before == nullptr) {
+            if (after->order >= ORDER_GAP) node->order = after->order - ORDER_GAP;
+            else if (after->order > 0) node->order = after->order / 2;
+            else relabelAround(node);
+        }
+        else if (after == nullptr) {
+            unsigned long long room = ULLONG_MAX - before->order;
+            if (room >= ORDER_GAP) node->order = before->order + ORDER_GAP;
+            else if (room > 0) node->order = before->order + (room + 1) / 2;
+            else relabelAround(node);
+        }
+        else {
+            // Relabel a neighbourhood when there is no free label left between the neighbours
+            if (after->order - before->order < 2) relabelAround(node);
+            else node->order = before->order + (after->order - before->order) / 2;
+        }
+    }
+
+    // Add a freshly linked node to all indexes
+    void index(LinkedList<Person>::iterator position) {
+        Person* node = &*position;
+        assignOrder(node);
+        linkName(node);
+        if (salaryIndex) salaryIndex->insert(node->salary, node);
+        if (ageIndex) ageIndex->insert(node->age, node);
+    }
+
+    // Remove a node from all indexes, then from the list
+    void unlink(Person* node) {
+        unlinkName(node);
+        if (salaryIndex) salaryIndex->erase(node->salary, node);
+        if (ageIndex) ageIndex->erase(node->age, node);
+        people.erase(people.iterator_to(*node));
+    }
+
+    // Insert a node into the chain of its name, keeping the chain in list order
+    void linkName(Person* node) {
+        if (node->name >= chains.size()) chains.resize(names.idLimit(), NameChain{nullptr, nullptr});
+        NameChain& chain = chains[node->name];
+
+        if (chain.first == nullptr) {
+            chain.first = chain.last = node;
+        }
+        else if (node->order < chain.first->order) {
+            // New earliest occurrence (always the case for addToBeginning)
+            node->nextSameName = chain.first;
+            chain.first->prevSameName = node;
+            chain.first = node;
+        }
+        else {
+            // Walk back from the latest occurrence; addToEnd stops immediately
+            Person* before = chain.last;
+            while (before->order > node->order) before = before->prevSameName;
+
+            node->prevSameName = before;
+            node->nextSameName = before->nextSameName;
+            if (before->nextSameName != nullptr) before->nextSameName->prevSameName = node;
+            else chain.last = node;
+            before->nextSameName = node;
+        }
+    }
+
+    // Remove a node from the chain of its name, releasing the name with the last one
+    void unlinkName(Person* node) {
+        NameChain& chain = chains[node->name];
+
+        if (node->prevSameName != nullptr) node->prevSameName->nextSameName = node->nextSameName;
+        else chain.first = node->nextSameName;
+        if (node->nextSameName != nullptr) node->nextSameName->prevSameName = node->prevSameName;
+        else chain.last = node->prevSameName;
+
+        if (chain.first == nullptr) names.release(node->name);
+    }
+
+    // Index every person by salary, or by age when bySalary is false
+    template <class Key>
+    unique_ptr<OrderedIndex<Key>> buildIndex(bool bySalary) const {
+        unique_ptr<OrderedIndex<Key>> index(new OrderedIndex<Key>());
+        for (const Person& person : people) {
+            index->insert(bySalary ? person.salary : person.age, &person);
+        }
+        return index;
+    }
+
+    // Find the first person with the given name, or nullptr
+    Person* findFirst(string_view targetName) const {
+        NameId id = names.find(targetName);  // The only hash of the query
+        return id != NamePool::NO_NAME ? chains[id].first : nullptr;
+    }
+
+public:
+    typedef LinkedList<Person>::const_iterator const_iterator;
+
+    // Constructor initializes the list to be empty
+    explicit PersonList(NodeAllocation allocation = NodeAllocation::Pool) : people(allocation) {}
+
+    // The list owns its nodes, so it must not be copied
+    PersonList(const PersonList&) = delete;
+    PersonList& operator=(const PersonList&) = delete;
+
+    // Names are interned: a node stores only a handle, and a name is copied
+    // once, into the pool, the first time it appears in the list.
+
+    // Add a person to the beginning of the list
+    void addToBeginning(string_view name, int age, double salary) {
+        index(people.emplace_front(names.intern(name), age, salary));
+    }
+
+    // Add a person to the end of the list
+    void addToEnd(string_view name, int age, double salary) {
+        index(people.emplace_back(names.intern(name), age, salary));
+    }
+
+    // Add a person after a given person's name
+    void addAfter(string_view targetName, string_view name, int age, double salary) {
+        Person* target = findFirst(targetName);
+
+        if (target != nullptr) {
+            // Target found, insert new node after it
+            index(people.emplace_after(people.iterator_to(*target), names.intern(name), age, salary));
+        }
+        else {
+            cout << "Person with the name " << targetName << " not found." << endl;
+        }
+    }
+
+    // Add a person before a given person's name
+    void addBefore(string_view targetName, string_view name, int age, double salary) {
+        if (people.empty()) {
+            cout << "The list is empty." << endl;
+            return;
+        }
+
+        Person* target = findFirst(targetName);
+
+        if (target != nullptr) {
+            // Target found, insert new node before it
+            index(people.emplace_before(people.iterator_to(*target), names.intern(name), age, salary));
+        }
+        else {
+            cout << "Person with the name " << targetName << " not found." << endl;
+        }
+    }
+
+    // Delete a person by their name
+    void deleteByName(string_view targetName) {
+        if (people.empty()) {
+            cout << "The list is empty." << endl;
+            return;
+        }
+
+        Person* target = findFirst(targetName);
+
+        if (target != nullptr) {
+            // Target found, delete it
+            unlink(target);
+        }
+        else {
+            cout << "Person with the name " << targetName << " not found." << endl;
+        }
+    }
+
+    // First person with the given name, or nullptr
+    const Person* find(string_view name) const { return findFirst(name); }
+
+    // Text of a person's name
+    const string& nameOf(const Person& person) const { return names.text(person.name); }
+
+    // The pool holding every name in the list
+    const NamePool& namePool() const { return names; }
+
+    // Prepare for adding people: one pool chunk for their nodes, and no rehashing
+    // of the name pool or regrowth of the name chains
+    void reserve(size_t peopleCount) {
+        people.reserve(peopleCount);
+        names.reserve(peopleCount);
+        chains.reserve(names.idLimit() + peopleCount);
+    }
+
+    // Iteration from head to tail; works with the standard algorithms
+    const_iterator begin() const { return people.begin(); }
+    const_iterator end() const { return people.end(); }
+
+    // Number of people in the list
+    size_t size() const { return people.size(); }
+
+    // Keep an ordered salary index up to date from now on
+    void enableSalaryIndex() {
+        if (!salaryIndex) salaryIndex = buildIndex<double>(true);
+    }
+
+    // Keep an ordered age index up to date from now on
+    void enableAgeIndex() {
+        if (!ageIndex) ageIndex = buildIndex<int>(false);
+    }
+
+    // Salary and age queries below take O(log n) with the matching index enabled;
+    // without it they build a temporary index, costing O(n log n) per call.
+
+    // Call visit(const Person&) for everyone with minSalary <= salary <= maxSalary, lowest salary first
+    template <class Visitor>
+    void forEachSalaryBetween(double minSalary, double maxSalary, Visitor visit) const {
+        if (salaryIndex) salaryIndex->forEachBetween(minSalary, maxSalary, visit);
+        else buildIndex<double>(true)->forEachBetween(minSalary, maxSalary, visit);
+    }
+
+    // Call visit(const Person&) for everyone with minAge <= age <= maxAge, youngest first
+    template <class Visitor>
+    void forEachAgeBetween(int minAge, int maxAge, Visitor visit) const {
+        if (ageIndex) ageIndex->forEachBetween(minAge, maxAge, visit);
+        else buildIndex<int>(false)->forEachBetween(minAge, maxAge, visit);
+    }
+
+    // The n best paid people, highest salary first
+    vector<const Person*> topBySalary(size_t n) const {
+        return salaryIndex ? salaryIndex->top(n) : buildIndex<double>(true)->top(n);
+    }
+
+    // Number of people earning strictly less than salary
+    size_t salaryRank(double salary) const {
+        return salaryIndex ? salaryIndex->rank(salary) : buildIndex<double>(true)->rank(salary);
+    }
+
+    // Number of people strictly younger than age
+    size_t ageRank(int age) const {
+        return ageIndex ? ageIndex->rank(age) : buildIndex<int>(false)->rank(age);
+    }
+
+    // Allocation mode chosen at construction
+    NodeAllocation allocationMode() const { return people.allocationMode(); }
+
+    // Call visit(const Person&) for every person from head to tail
+    template <class Visitor>
+    void forEach(Visitor visit) const {
+        for (const Person& person : people) visit(person);
+    }
+
+    // Print the entire list
+    void printList() const {
+        for (const Person& person : people) {
+            cout << "Name: " << nameOf(person)
+                 << ", Age: " << person.age
+                 << ", Salary: " << person.salary << endl;
+        }
+    }
+};
+
+// One person stored inside an UnrolledPersonList block
+struct PersonRecord {
+    string name;    // Person's name
+    int age;        // Person's age
+    double salary;  // Person's salary
+};
+
+// List of people with the same operations as PersonList, storing several
+// people per block (an unrolled linked list). Traversal and name search
+// follow one pointer per block instead of one per person.
+class UnrolledPersonList {
+public:
+    static const int BLOCK_CAPACITY = 16; // People per block
+
+private:
+    struct Block {
+        PersonRecord records[BLOCK_CAPACITY]; // The first used entries are valid
+        int used;      // Number of valid records
+        Block* next;   // Pointer to the next block
+        Block* prev;   // Pointer to the previous block
+
+        Block() : used(0), next(nullptr), prev(nullptr) {}
+    };
+
+    Block* head;   // Pointer to the first block
+    Block* tail;   // Pointer to the last block
+    size_t count;  // Number of people in the list
+
+    // Link a new empty block after the given one (at the front if null)
+    Block* insertBlockAfter(Block* before) {
+        Block* block = new Block();
+        Block* after = before != nullptr ? before->next : head;
+        block->prev = before;
+        block->next = after;
+        if (before != nullptr) before->next = block; else head = block;
+        if (after != nullptr) after->prev = block; else tail = block;
+        return block;
+    }
+
+    // Unlink and free a block
+    void removeBlock(Block* block) {
+        if (block->prev != nullptr) block->prev->next = block->next; else head = block->next;
+        if (block->next != nullptr) block->next->prev = block->prev; else tail = block->prev;
+        delete block;
+    }
+
+    // Move the upper half of a full block into a new block after it
+    void split(Block* block) {
+        Block* upper = insertBlockAfter(block);
+        int keep = block->used / 2;
+        for (int i = keep; i < block->used; i++) {
+            upper->records[i - keep] = std::move(block->records[i]);
+        }
+        upper->used = block->used - keep;
+        block->used = keep;
+    }
+
+    // Move every record of the next block into this one and free the next block
+    void mergeNext(Block* block) {
+        Block* following = block->next;
+        for (int i = 0; i < following->used; i++) {
+            block->records[block->used + i] = std::move(following->records[i]);
+        }
+        block->used += following->used;
+        removeBlock(following);
+    }
+
+    // Insert a record at position index (0..used) of a block, splitting it when full
+    void insertAt(Block* block, int index, PersonRecord&& record) {
+        if (block->used == BLOCK_CAPACITY) {
+            split(block);
+            if (index > block->used) {
+                index -= block->used;
+                block = block->next;
+            }
+        }
+        for (int i = block->used; i > index; i--) block->records[i] = std::move(block->records[i - 1]);
+        block->records[index] = std::move(record);
+        block->used++;
+        count++;
+    }
+
+    // Remove the record at position index of a block, merging underfull blocks
+    void eraseAt(Block* block, int index) {
+        for (int i = index; i + 1 < block->used; i++) block->records[i] = std::move(block->records[i + 1]);
+        block->used--;
+        block->records[block->used] = PersonRecord(); // Release the name of the vacated slot
+        count--;
+
+        if (block->used == 0) {
+            removeBlock(block);
+        }
+        else if (block->used < BLOCK_CAPACITY / 2) {
+            // Keep blocks at least half full where a neighbour can take the records
+            if (block->next != nullptr && block->used + block->next->used <= BLOCK_CAPACITY) mergeNext(block);
+            else if (block->prev != nullptr && block->prev->used + block->used <= BLOCK_CAPACITY) mergeNext(block->prev);
+        }
+    }
+
+    // Find the first record with the given name
+    bool locate(string_view targetName, Block*& block, int& index) const {
+        for (block = head; block != nullptr; block = block->next) {
+            for (index = 0; index < block->used; index++) {
+                if (block->records[index].name == targetName) return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    // Constructor initializes the list to be empty
+    UnrolledPersonList() : head(nullptr), tail(nullptr), count(0) {}
+
+    // The list owns its blocks, so it must not be copied
+    UnrolledPersonList(const UnrolledPersonList&) = delete;
+    UnrolledPersonList& operator=(const UnrolledPersonList&) = delete;
+
+    // Destructor to free memory of all blocks
+    ~UnrolledPersonList() {
+        while (head != nullptr) {
+            Block* temp = head;
+            head = head->next;
+            delete temp;
+        }
+    }
+
+    // Add a person to the beginning of the list
+    void addToBeginning(string name, int age, double salary) {
+        if (head == nullptr) insertBlockAfter(nullptr);
+        insertAt(head, 0, PersonRecord{std::move(name), age, salary});
+    }
+
+    // Add a person to the end of the list; full blocks stay full
+    void addToEnd(string name, int age, double salary) {
+        if (tail == nullptr || tail->used == BLOCK_CAPACITY) insertBlockAfter(tail);
+        insertAt(tail, tail->used, PersonRecord{std::move(name), age, salary});
+    }
+
+    // Add a person after a given person's name
+    void addAfter(string_view targetName, string name, int age, double salary) {
+        Block* block;
+        int index;
+
+        if (locate(targetName, block, index)) {
+            // Target found, insert new record after it
+            insertAt(block, index + 1, PersonRecord{std::move(name), age, salary});
+        }
+        else {
+            cout << "Person with the name " << targetName << " not found." << endl;
+        }
+    }
+
+    // Add a person before a given person's name
+    void addBefore(string_view targetName, string name, int age, double salary) {
+        if (head == nullptr) {
+            cout << "The list is empty." << endl;
+            return;
+        }
+
+        Block* block;
+        int index;
+
+        if (locate(targetName, block, index)) {
+            // Target found, insert new record before it
+            insertAt(block, index, PersonRecord{std::move(name), age, salary});
+        }
+        else {
+            cout << "Person with the name " << targetName << " not found." << endl;
+        }
+    }
+
+    // Delete a person by their name
+    void deleteByName(string_view targetName) {
+        if (head == nullptr) {
+            cout << "The list is empty." << endl;
+            return;
+        }
+
+        Block* block;
+        int index;
+
+        if (locate(targetName, block, index)) {
+            // Target found, delete it
+            eraseAt(block, index);
+        }
+        else {
+            cout << "Person with the name " << targetName << " not found." << endl;
+        }
+    }
+
+    // First person with the given name, or nullptr
+    const PersonRecord* find(string_view name) const {
+        Block* block;
+        int index;
+        return locate(name, block, index) ? &block->records[index] : nullptr;
+    }
+
+    // Number of people in the list
+    size_t size() const { return count; }
+
+    // Number of blocks currently in use
+    size_t blockCount() const {
+        size_t blocks = 0;
+        for (Block* block = head; block != nullptr; block = block->next) blocks++;
+        return blocks;
+    }
+
+    // Call visit(const PersonRecord&) for every person from head to tail
+    template <class Visitor>
+    void forEach(Visitor visit) const {
+        for (const Block* block = head; block != nullptr; block = block->next) {
+            for (int i = 0; i < block->used; i++) visit(block->records[i]);
+        }
+    }
+
+    // Print the entire list
+    void printList() const {
+        forEach([](const PersonRecord& person) {
+            cout << "Name: " << person.name
+                 << ", Age: " << person.age
+                 << ", Salary: " << person.salary << endl;
+        });
+    }
+};
+
+// Aggregate of a set of salaries
+struct SalaryStats {
+    size_t count;  // Number of salaries aggregated
+    double sum;    // Total of all salaries
+    double min;    // Smallest salary (0 if count is 0)
+    double max;    // Largest salary (0 if count is 0)
+
+    double mean() const { return count != 0 ? sum / count : 0.0; }
+};
+
+// Bitmap of selected row numbers in a PersonStore
+class Selection {
+private:
+    vector<uint64_t> words;  // Bit i of word i / 64 is row i
+    size_t rows;             // Number of rows the bitmap covers
+
+public:
+    explicit Selection(size_t rows = 0) : words((rows + 63) / 64, 0), rows(rows) {}
+
+    bool test(size_t row) const { return (words[row / 64] >> (row % 64)) & 1; }
+    void set(size_t row) { words[row / 64] |= uint64_t(1) << (row % 64); }
+
+    // Set up to 8 consecutive bits starting at a row that is a multiple of 8
+    void setByte(size_t row, unsigned bits) { words[row / 64] |= uint64_t(bits) << (row % 64); }
+
+    // Number of selected rows
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t word : words) total += bitset<64>(word).count();
+        return total;
+    }
+
+    size_t size() const { return rows; }
+    const vector<uint64_t>& bits() const { return words; }
+};
+
+// Columnar (struct-of-arrays) copy of people for analytics over ages and salaries
+class PersonStore {
+private:
+    vector<string> names;     // Name column
+    vector<int> ages;         // Age column
+    vector<double> salaries;  // Salary column
+
+    // Fold one salary into running statistics
+    static void accumulate(SalaryStats& stats, double salary) {
+        stats.count++;
+        stats.sum += salary;
+        if (salary < stats.min) stats.min = salary;
+        if (salary > stats.max) stats.max = salary;
+    }
+
+    // Statistics with no salaries yet, ready for accumulate
+    static SalaryStats emptyStats() {
+        return SalaryStats{0, 0.0, numeric_limits<double>::infinity(), -numeric_limits<double>::infinity()};
+    }
+
+    // Replace the infinities of an empty aggregate with zeros
+    static SalaryStats finish(SalaryStats stats) {
+        if (stats.count == 0) stats.min = stats.max = 0.0;
+        return stats;
+    }
+
+public:
+    // Copy every person of a list, keeping list order as row order
+    static PersonStore fromList(const PersonList& list) {
+        PersonStore store;
+        store.reserve(list.size());
+        list.forEach([&store, &list](const Person& person) {
+            store.add(list.nameOf(person), person.age, person.salary);
+        });
+        return store;
+    }
+
+    // Append every row to the end of a list
+    void appendTo(PersonList& list) const {
+        for (size_t i = 0; i < names.size(); i++) list.addToEnd(names[i], ages[i], salaries[i]);
+    }
+
+    void reserve(size_t rows) {
+        names.reserve(rows);
+        ages.reserve(rows);
+        salaries.reserve(rows);
+    }
+
+    // Add one row
+    void add(string name, int age, double salary) {
+        names.push_back(std::move(name));
+        ages.push_back(age);
+        salaries.push_back(salary);
+    }
+
+    size_t size() const { return names.size(); }
+    const string& nameAt(size_t row) const { return names[row]; }
+    int ageAt(size_t row) const { return ages[row]; }
+    double salaryAt(size_t row) const { return salaries[row]; }
+
+    // Sum, min, max and mean of all salaries in one vectorized pass
+    SalaryStats salaryStats() const {
+        const double* column = salaries.data();
+        size_t n = salaries.size();
+        size_t i = 0;
+        SalaryStats stats = emptyStats();
+
+#if defined(__AVX2__)
+        const int LANES = 4;
+        __m256d sum = _mm256_setzero_pd();
+        __m256d low = _mm256_set1_pd(stats.min);
+        __m256d high = _mm256_set1_pd(stats.max);
+        for (; i + LANES <= n; i += LANES) {
+            __m256d value = _mm256_loadu_pd(column + i);
+            sum = _mm256_add_pd(sum, value);
+            low = _mm256_min_pd(low, value);
+            high = _mm256_max_pd(high, value);
+        }
+        double laneSum[LANES], laneMin[LANES], laneMax[LANES];
+        _mm256_storeu_pd(laneSum, sum);
+        _mm256_storeu_pd(laneMin, low);
+        _mm256_storeu_pd(laneMax, high);
+#elif defined(__SSE2__)
+        const int LANES = 2;
+        __m128d sum = _mm_setzero_pd();
+        __m128d low = _mm_set1_pd(stats.min);
+        __m128d high = _mm_set1_pd(stats.max);
+        for (; i + LANES <= n; i += LANES) {
+            __m128d value = _mm_loadu_pd(column + i);
+            sum = _mm_add_pd(sum, value);
+            low = _mm_min_pd(low, value);
+            high = _mm_max_pd(high, value);
+        }
+        double laneSum[LANES], laneMin[LANES], laneMax[LANES];
+        _mm_storeu_pd(laneSum, sum);
+        _mm_storeu_pd(laneMin, low);
+        _mm_storeu_pd(laneMax, high);
+#else
+        const int LANES = 0;
+        double laneSum[1], laneMin[1], laneMax[1];
+#endif
+
+        // Combine the partial results of each register lane
+        for (int lane = 0; lane < LANES; lane++) {
+            stats.sum += laneSum[lane];
+            if (laneMin[lane] < stats.min) stats.min = laneMin[lane];
+            if (laneMax[lane] > stats.max) stats.max = laneMax[lane];
+        }
+        stats.count = i;
+
+        // Remaining rows that do not fill a whole register
+        for (; i < n; i++) accumulate(stats, column[i]);
+        return finish(stats);
+    }
+
+    // Sum, min, max and mean of the salaries of selected rows only
+    SalaryStats salaryStats(const Selection& selection) const {
+        SalaryStats stats = emptyStats();
+        const vector<uint64_t>& words = selection.bits();
+        for (size_t w = 0; w < words.size(); w++) {
+            if (words[w] == 0) continue;  // Skip 64 unselected rows at once
+            for (size_t bit = 0; bit < 64; bit++) {
+                if ((words[w] >> bit) & 1) accumulate(stats, salaries[w * 64 + bit]);
+            }
+        }
+        return finish(stats);
+    }
+
+    // Select rows with minAge <= age <= maxAge
+    Selection selectAgeRange(int minAge, int maxAge) const {
+        const int* column = ages.data();
+        size_t n = ages.size();
+        size_t i = 0;
+        Selection selection(n);
+
+#if defined(__AVX2__)
+        __m256i low = _mm256_set1_epi32(minAge);
+        __m256i high = _mm256_set1_epi32(maxAge);
+        for (; i + 8 <= n; i += 8) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column + i));
+            __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(low, value), _mm256_cmpgt_epi32(value, high));
+            unsigned bits = ~unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(outside))) & 0xFF;
+            selection.setByte(i, bits);
+        }
+#elif defined(__SSE2__)
+        __m128i low = _mm_set1_epi32(minAge);
+        __m128i high = _mm_set1_epi32(maxAge);
+        for (; i + 8 <= n; i += 8) {
+            // Two 4-lane compares make one byte of the bitmap
+            unsigned bits = 0;
+            for (int half = 0; half < 2; half++) {
+                __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i + 4 * half));
+                __m128i outside = _mm_or_si128(_mm_cmplt_epi32(value, low), _mm_cmpgt_epi32(value, high));
+                bits |= (~unsigned(_mm_movemask_ps(_mm_castsi128_ps(outside))) & 0xF) << (4 * half);
+            }
+            selection.setByte(i, bits);
+        }
+#endif
+
+        for (; i < n; i++) {
+            if (column[i] >= minAge && column[i] <= maxAge) selection.set(i);
+        }
+        return selection;
+    }
+
+    // Salary statistics per age band: key is the first age of a band of bandWidth years.
+    // A band width below 1 is reported and gives no bands.
+    map<int, SalaryStats> salaryByAgeBand(int bandWidth) const {
+        map<int, SalaryStats> groups;
+        if (bandWidth <= 0) {
+            cerr << "Error: Age band width must be positive: " << bandWidth << endl;
+            return groups;
+        }
+        for (size_t i = 0; i < ages.size(); i++) {
+            int band = ages[i] / bandWidth;
+            if (ages[i] < 0 && ages[i] % bandWidth != 0) band--; // Round negative ages down too
+            auto found = groups.emplace(band * bandWidth, emptyStats()).first;
+            accumulate(found->second, salaries[i]);
+        }
+        return groups;
+    }
+};
+
+// Node of ConcurrentPersonList; every node carries its own lock
+class ConcurrentPerson {
 public:
-    string name;       // Person's name
-    int age;           // Person's age
-    double salary;     // Person's salary
-    Person* next;      // Pointer to the next person in the list
+    string name;             // Person's name
+    int age;                 // Person's age
+    double salary;           // Person's salary
+    ConcurrentPerson* next;  // Next node (guarded by this node's lock)
+    ConcurrentPerson* prev;  // Previous node (guarded by this node's lock)
+    mutex lock;              // Held while reading or changing the links around this node
 
-    // Constructor to initialize the person object
-    Person(string name, int age, double salary)
-        : name(name), age(age), salary(salary), next(nullptr) {}
+    ConcurrentPerson(string name, int age, double salary)
+        : name(std::move(name)), age(age), salary(salary), next(nullptr), prev(nullptr) {}
 };
 
-// Class representing the linked list of people
-class PersonList {
+// Thread-safe list of people with one lock per node and a name index.
+// Operations on a named person find its node through the index instead of walking
+// the list, then lock only the nodes around it. The index is split into stripes by
+// the hash of the name, each with its own lock and the first node and count of
+// every name in it. Lock order: stripes before nodes, lower stripes first; nodes
+// from head towards tail. The backward steps (to a node's predecessor) use try_lock
+// and retry, so no thread can wait on a lock while blocking another thread going
+// forward. Linking or unlinking a node named X holds X's stripe, so a node found
+// through the index stays alive until that stripe is unlocked. A node is only
+// unlinked while its predecessor, itself and its successor are locked, so nobody
+// walking the list can hold a pointer to it when it is freed.
+class ConcurrentPersonList {
 private:
-    Person* head;  // Pointer to the first element of the list
+    // First node of a name in list order and the number of nodes with that name
+    struct NameEntry {
+        ConcurrentPerson* first;
+        size_t count;
+    };
+
+    // Name with its hash, computed once per operation and reused by the index
+    struct HashedName {
+        string_view text;
+        size_t hash;
+
+        explicit HashedName(string_view text) : text(text), hash(std::hash<string_view>()(text)) {}
+        HashedName(string_view text, size_t hash) : text(text), hash(hash) {}
+        bool operator==(const HashedName& other) const { return hash == other.hash && text == other.text; }
+    };
+
+    struct HashedNameHash {
+        size_t operator()(const HashedName& name) const { return name.hash; }
+    };
+
+    typedef unordered_map<HashedName, NameEntry, HashedNameHash> NameIndex;  // Keys view into first->name
+
+    // Part of the name index with its own lock; separate cache lines keep threads
+    // working on different stripes from slowing each other down
+    struct alignas(64) IndexStripe {
+        mutex lock;
+        NameIndex names;
+    };
+
+    // Where a new node was linked relative to the other nodes of its name
+    enum class Placement { Front, Back, Unknown };
+
+    static const size_t INDEX_STRIPES = 64;
+
+    ConcurrentPerson head;  // Sentinel before the first person
+    ConcurrentPerson tail;  // Sentinel after the last person
+    atomic<size_t> count;   // Number of people in the list
+    IndexStripe stripes[INDEX_STRIPES];
+
+    // Stripe of a name; other hash bits than the ones the stripe's table uses
+    IndexStripe& stripeOf(const HashedName& name) { return stripes[(name.hash >> 16) % INDEX_STRIPES]; }
+
+    // Lock the stripes of two names, lower index first; the second lock is empty when
+    // both names share a stripe
+    pair<unique_lock<mutex>, unique_lock<mutex>> lockStripes(const HashedName& a, const HashedName& b) {
+        size_t low = &stripeOf(a) - stripes, high = &stripeOf(b) - stripes;
+        if (low > high) swap(low, high);
+        unique_lock<mutex> first(stripes[low].lock);
+        unique_lock<mutex> second;
+        if (high != low) second = unique_lock<mutex>(stripes[high].lock);
+        return make_pair(std::move(first), std::move(second));
+    }
+
+    // First node named targetName according to the index, or nullptr.
+    // The name's stripe must be locked.
+    ConcurrentPerson* findIndexed(const HashedName& targetName) {
+        NameIndex& names = stripeOf(targetName).names;
+        auto found = names.find(targetName);
+        return found != names.end() ? found->second.first : nullptr;
+    }
+
+    // First node named targetName in list order, found by walking from the head.
+    // Only needed for repeated names; the name's stripe must be locked and no node.
+    ConcurrentPerson* walkToFirst(string_view targetName) {
+        ConcurrentPerson* pred = &head;
+        pred->lock.lock();
+        ConcurrentPerson* curr = pred->next;
+        curr->lock.lock();
+        while (curr != &tail && curr->name != targetName) {
+            pred->lock.unlock();
+            pred = curr;
+            curr = curr->next;
+            curr->lock.lock();
+        }
+        curr->lock.unlock();
+        pred->lock.unlock();
+        return curr != &tail ? curr : nullptr;
+    }
+
+    // Make node the indexed first node of its name, keeping the count
+    void setFirst(NameIndex& names, NameIndex::iterator entry, ConcurrentPerson* node) {
+        if (entry->second.first == node) return;
+        HashedName key(node->name, entry->first.hash);
+        size_t nameCount = entry->second.count;
+        names.erase(entry);  // The key views into the old first node's name
+        names.emplace(key, NameEntry{node, nameCount});
+    }
+
+    // Record a node that was just linked; name is its name, whose stripe must be
+    // locked, and no node may be
+    void indexLinked(ConcurrentPerson* node, const HashedName& name, Placement placement) {
+        NameIndex& names = stripeOf(name).names;
+        auto found = names.find(name);
+        if (found == names.end()) {
+            names.emplace(name, NameEntry{node, 1});
+            return;
+        }
+        found->second.count++;
+        if (placement == Placement::Front) setFirst(names, found, node);
+        else if (placement == Placement::Unknown) setFirst(names, found, walkToFirst(name.text));
+    }
+
+    // Forget the first node of a name, which was just unlinked; the name's stripe must
+    // be locked and no node
+    void indexUnlinked(const HashedName& name) {
+        NameIndex& names = stripeOf(name).names;
+        auto found = names.find(name);
+        if (--found->second.count == 0) names.erase(found);
+        else setFirst(names, found, walkToFirst(name.text));
+    }
+
+    // Lock node and its predecessor and return the predecessor. Taking the
+    // predecessor is a backward step, so it is only tried; on failure node is
+    // released and both are taken again. Holding node keeps its prev link fixed.
+    ConcurrentPerson* lockWithPredecessor(ConcurrentPerson* node) {
+        while (true) {
+            node->lock.lock();
+            ConcurrentPerson* pred = node->prev;
+            if (pred->lock.try_lock()) return pred;
+            node->lock.unlock();
+            this_thread::yield();
+        }
+    }
+
+    // Link a node between two locked neighbours
+    void link(ConcurrentPerson* before, ConcurrentPerson* after, ConcurrentPerson* node) {
+        node->prev = before;
+        node->next = after;
+        before->next = node;
+        after->prev = node;
+        count++;
+    }
 
 public:
     // Constructor initializes the list to be empty
-    PersonList() : head(nullptr) {}
+    ConcurrentPersonList() : head("", 0, 0), tail("", 0, 0), count(0) {
+        head.next = &tail;
+        tail.prev = &head;
+    }
 
-    // Destructor to free memory of all nodes
-    ~PersonList() {
-        while (head != nullptr) {
-            Person* temp = head;
-            head = head->next;
+    ConcurrentPersonList(const ConcurrentPersonList&) = delete;
+    ConcurrentPersonList& operator=(const ConcurrentPersonList&) = delete;
+
+    // Destructor to free memory of all nodes; no other thread may use the list
+    ~ConcurrentPersonList() {
+        ConcurrentPerson* temp = head.next;
+        while (temp != &tail) {
+            ConcurrentPerson* following = temp->next;
             delete temp;
+            temp = following;
         }
     }
 
     // Add a person to the beginning of the list
     void addToBeginning(string name, int age, double salary) {
-        Person* newNode = new Person(name, age, salary);
-        newNode->next = head;
-        head = newNode;
+        ConcurrentPerson* node = new ConcurrentPerson(std::move(name), age, salary);
+        HashedName key(node->name);
+        lock_guard<mutex> stripeGuard(stripeOf(key).lock);
+        {
+            lock_guard<mutex> headGuard(head.lock);
+            ConcurrentPerson* first = head.next;
+            lock_guard<mutex> firstGuard(first->lock);
+            link(&head, first, node);
+        }
+        indexLinked(node, key, Placement::Front);
     }
 
     // Add a person to the end of the list
     void addToEnd(string name, int age, double salary) {
-        Person* newNode = new Person(name, age, salary);
-
-        if (head == nullptr) {
-            // If list is empty, new node becomes the head
-            head = newNode;
-        }
-        else {
-            // Traverse to the last node
-            Person* temp = head;
-            while (temp->next != nullptr) {
-                temp = temp->next;
+        ConcurrentPerson* node = new ConcurrentPerson(std::move(name), age, salary);
+        HashedName key(node->name);
+        lock_guard<mutex> stripeGuard(stripeOf(key).lock);
+        while (true) {
+            tail.lock.lock();
+            ConcurrentPerson* last = tail.prev;
+            // Stepping backwards: never block here, back off instead
+            if (last->lock.try_lock()) {
+                link(last, &tail, node);
+                last->lock.unlock();
+                tail.lock.unlock();
+                break;
             }
-            temp->next = newNode;
+            tail.lock.unlock();
+            this_thread::yield();
         }
+        indexLinked(node, key, Placement::Back);
     }
 
     // Add a person after a given person's name
-    void addAfter(string targetName, string name, int age, double salary) {
-        Person* temp = head;
-
-        // Search for the target name
-        while (temp != nullptr && temp->name != targetName) {
-            temp = temp->next;
-        }
-
-        if (temp != nullptr) {
-            // Target found, insert new node after it
-            Person* newNode = new Person(name, age, salary);
-            newNode->next = temp->next;
-            temp->next = newNode;
-        }
-        else {
+    void addAfter(string_view targetName, string name, int age, double salary) {
+        ConcurrentPerson* node = new ConcurrentPerson(std::move(name), age, salary);
+        HashedName targetKey(targetName), key(node->name);
+        pair<unique_lock<mutex>, unique_lock<mutex>> stripeGuards = lockStripes(targetKey, key);
+        ConcurrentPerson* target = findIndexed(targetKey);
+        if (target == nullptr) {
+            stripeGuards = {};  // Unlock before printing
+            delete node;
             cout << "Person with the name " << targetName << " not found." << endl;
+            return;
         }
+
+        // Target found, insert new node after it
+        target->lock.lock();
+        ConcurrentPerson* following = target->next;
+        following->lock.lock();
+        link(target, following, node);
+        following->lock.unlock();
+        target->lock.unlock();
+        indexLinked(node, key, Placement::Unknown);
     }
 
     // Add a person before a given person's name
-    void addBefore(string targetName, string name, int age, double salary) {
-        if (head == nullptr) {
-            cout << "The list is empty." << endl;
+    void addBefore(string_view targetName, string name, int age, double salary) {
+        ConcurrentPerson* node = new ConcurrentPerson(std::move(name), age, salary);
+        HashedName targetKey(targetName), key(node->name);
+        pair<unique_lock<mutex>, unique_lock<mutex>> stripeGuards = lockStripes(targetKey, key);
+        ConcurrentPerson* target = findIndexed(targetKey);
+        if (target == nullptr) {
+            stripeGuards = {};  // Unlock before printing
+            delete node;
+            cout << "Person with the name " << targetName << " not found." << endl;
             return;
         }
 
-        // If the target is the head, add to beginning
-        if (head->name == targetName) {
-            addToBeginning(name, age, salary);
+        // Target found, insert new node before it
+        ConcurrentPerson* pred = lockWithPredecessor(target);
+        link(pred, target, node);
+        target->lock.unlock();
+        pred->lock.unlock();
+        indexLinked(node, key, Placement::Unknown);
+    }
+
+    // Delete a person by their name
+    void deleteByName(string_view targetName) {
+        HashedName key(targetName);
+        unique_lock<mutex> stripeGuard(stripeOf(key).lock);
+        ConcurrentPerson* target = findIndexed(key);
+        if (target == nullptr) {
+            stripeGuard.unlock();
+            cout << "Person with the name " << targetName << " not found." << endl;
             return;
         }
 
-        // Traverse the list looking for the node before the target
-        Person* temp = head;
-        while (temp->next != nullptr && temp->next->name != targetName) {
+        // Target found, unlink it with all three affected nodes locked
+        ConcurrentPerson* pred = lockWithPredecessor(target);
+        ConcurrentPerson* following = target->next;
+        following->lock.lock();
+        pred->next = following;
+        following->prev = pred;
+        count--;
+        following->lock.unlock();
+        target->lock.unlock();
+        pred->lock.unlock();
+        indexUnlinked(HashedName(target->name, key.hash));
+        stripeGuard.unlock();
+        delete target;
+    }
+
+    // Whether a person with the given name is in the list
+    bool contains(string_view targetName) {
+        HashedName key(targetName);
+        lock_guard<mutex> stripeGuard(stripeOf(key).lock);
+        return findIndexed(key) != nullptr;
+    }
+
+    // Number of people in the list
+    size_t size() const { return count.load(); }
+
+    // Call visit(const ConcurrentPerson&) for every person from head to tail.
+    // The visited node stays locked during the call, so visit must not use the list.
+    template <class Visitor>
+    void forEach(Visitor visit) {
+        ConcurrentPerson* pred = &head;
+        pred->lock.lock();
+        ConcurrentPerson* curr = pred->next;
+        curr->lock.lock();
+        while (curr != &tail) {
+            pred->lock.unlock();
+            visit(static_cast<const ConcurrentPerson&>(*curr));
+            pred = curr;
+            curr = curr->next;
+            curr->lock.lock();
+        }
+        curr->lock.unlock();
+        pred->lock.unlock();
+    }
+
+    // Print the entire list
+    void printList() {
+        forEach([](const ConcurrentPerson& person) {
+            cout << "Name: " << person.name
+                 << ", Age: " << person.age
+                 << ", Salary: " << person.salary << endl;
+        });
+    }
+
+    // Check that forward and backward links agree and match the size, and that the
+    // index holds the first node and the count of every name in the list.
+    // Only meaningful while no other thread changes the list.
+    bool isConsistent() const {
+        size_t seen = 0;
+        unordered_map<string_view, pair<const ConcurrentPerson*, size_t>> names;  // First node, count
+        const ConcurrentPerson* temp = &head;
+        while (temp != &tail) {
+            if (temp->next->prev != temp) return false;
             temp = temp->next;
+            if (temp != &tail) {
+                seen++;
+                names.emplace(string_view(temp->name), make_pair(temp, 0)).first->second.second++;
+            }
+        }
+        size_t indexed = 0;
+        for (const IndexStripe& stripe : stripes) {
+            indexed += stripe.names.size();
+            for (const auto& entry : stripe.names) {
+                auto found = names.find(entry.first.text);
+                if (found == names.end() || found->second.first != entry.second.first ||
+                    found->second.second != entry.second.count) return false;
+            }
         }
+        return seen == count.load() && indexed == names.size();
+    }
+};
 
-        if (temp->next != nullptr) {
-            // Target found, insert new node before it
-            Person* newNode = new Person(name, age, salary);
-            newNode->next = temp->next;
-            temp->next = newNode;
+// Run mixed operations from many threads and verify the final list.
+// Each thread works on its own names, so the expected contents are known.
+int runConcurrentStressTest(int threadCount, int opsPerThread) {
+    ConcurrentPersonList list;
+    vector<vector<string>> expected(threadCount);  // Names each thread left in the list
+    atomic<bool> writersDone(false);
+    atomic<size_t> visited(0);
+
+    vector<thread> writers;
+    for (int t = 0; t < threadCount; t++) {
+        writers.emplace_back([&list, &expected, t, opsPerThread]() {
+            mt19937 random(t + 1);
+            vector<string>& mine = expected[t];
+            for (int i = 0; i < opsPerThread; i++) {
+                string name = "T" + to_string(t) + "-" + to_string(i);
+                int operation = mine.empty() ? random() % 2 : random() % 5;
+                if (operation == 0) list.addToBeginning(name, i % 80, i);
+                else if (operation == 1) list.addToEnd(name, i % 80, i);
+                else if (operation == 2) list.addAfter(mine[random() % mine.size()], name, i % 80, i);
+                else if (operation == 3) list.addBefore(mine[random() % mine.size()], name, i % 80, i);
+                else {
+                    // Delete one of this thread's own names
+                    size_t victim = random() % mine.size();
+                    list.deleteByName(mine[victim]);
+                    mine[victim] = mine.back();
+                    mine.pop_back();
+                    continue;
+                }
+                mine.push_back(name);
+            }
+        });
+    }
+
+    // A reader traverses the list while writers are running
+    thread reader([&list, &writersDone, &visited]() {
+        while (!writersDone.load()) {
+            list.forEach([&visited](const ConcurrentPerson&) { visited++; });
         }
-        else {
-            cout << "Person with the name " << targetName << " not found." << endl;
+    });
+
+    for (thread& writer : writers) writer.join();
+    writersDone = true;
+    reader.join();
+
+    // Every surviving name must appear exactly once
+    unordered_map<string, int> remaining;
+    list.forEach([&remaining](const ConcurrentPerson& person) { remaining[person.name]++; });
+
+    size_t expectedCount = 0;
+    bool passed = list.isConsistent();
+    for (const vector<string>& mine : expected) {
+        expectedCount += mine.size();
+        for (const string& name : mine) {
+            if (remaining[name] != 1) passed = false;
         }
     }
+    if (expectedCount != list.size() || remaining.size() != expectedCount) passed = false;
 
-    // Delete a person by their name
-    void deleteByName(string targetName) {
-        if (head == nullptr) {
-            cout << "The list is empty." << endl;
-            return;
+    cout << "Stress test with " << threadCount << " threads x " << opsPerThread << " operations: "
+         << (passed ? "passed" : "FAILED") << " (" << list.size() << " people left, "
+         << visited.load() << " nodes visited by the reader)" << endl;
+    return passed ? 0 : 1;
+}
+
+// Measure throughput of ConcurrentPersonList for 1..maxThreads threads, next to a
+// plain PersonList behind one mutex. The list is first filled with BASE_PEOPLE
+// people; every operation then targets a random one of them, so lookups, inserts
+// and deletes land all over the list instead of queueing at the head or tail.
+// Prints one CSV line per run.
+void runConcurrentBenchmark(int maxThreads, int opsPerThread) {
+    const int BASE_PEOPLE = 1000;
+    cout << "list,threads,operations,seconds,ops_per_second" << endl;
+
+    // Thread counts 1, 2, 4, ... and finally maxThreads itself
+    vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (int threads : threadCounts) {
+        for (int variant = 0; variant < 2; variant++) {
+            ConcurrentPersonList concurrentList;
+            PersonList plainList;
+            mutex plainLock;
+            for (int i = 0; i < BASE_PEOPLE; i++) {
+                if (variant == 0) concurrentList.addToEnd("P" + to_string(i), 30, i);
+                else plainList.addToEnd("P" + to_string(i), 30, i);
+            }
+
+            // 40% lookups, 20% inserts after and 20% before a random person,
+            // 20% deletes of a person this thread inserted earlier
+            atomic<size_t> hits(0);
+            auto work = [&](int t) {
+                mt19937 random(t + 1);
+                vector<string> mine;  // Names this thread inserted and has not deleted
+                size_t found = 0;
+                for (int i = 0; i < opsPerThread; i++) {
+                    string target = "P" + to_string(random() % BASE_PEOPLE);
+                    int operation = random() % 5;
+                    if (operation == 4 && mine.empty()) operation = 0;
+                    if (operation <= 1) {
+                        if (variant == 0) found += concurrentList.contains(target);
+                        else {
+                            lock_guard<mutex> guard(plainLock);
+                            found += plainList.find(target) != nullptr;
+                        }
+                    }
+                    else if (operation <= 3) {
+                        string name = "T" + to_string(t) + "-" + to_string(i);
+                        if (variant == 0 && operation == 2) concurrentList.addAfter(target, name, 30, i);
+                        else if (variant == 0) concurrentList.addBefore(target, name, 30, i);
+                        else {
+                            lock_guard<mutex> guard(plainLock);
+                            if (operation == 2) plainList.addAfter(target, name, 30, i);
+                            else plainList.addBefore(target, name, 30, i);
+                        }
+                        mine.push_back(std::move(name));
+                    }
+                    else {
+                        size_t victim = random() % mine.size();
+                        if (variant == 0) concurrentList.deleteByName(mine[victim]);
+                        else {
+                            lock_guard<mutex> guard(plainLock);
+                            plainList.deleteByName(mine[victim]);
+                        }
+                        mine[victim] = std::move(mine.back());
+                        mine.pop_back();
+                    }
+                }
+                hits += found;
+            };
+
+            auto start = chrono::steady_clock::now();
+            vector<thread> workers;
+            for (int t = 0; t < threads; t++) workers.emplace_back(work, t);
+            for (thread& worker : workers) worker.join();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            long long operations = (long long)threads * opsPerThread;
+            cout << (variant == 0 ? "concurrent" : "mutex+PersonList") << "," << threads << ","
+                 << operations << "," << seconds << "," << operations / seconds << endl;
+            if (hits.load() > (size_t)operations) cout << hits.load() << endl;  // Keep lookups alive
         }
+    }
+}
 
-        // If the head is the target
-        if (head->name == targetName) {
-            Person* temp = head;
-            head = head->next;
-            delete temp;
-            return;
+// Binary snapshot of a PersonList:
+//   SnapshotHeader, then count SnapshotRecord entries, then nameBytes of
+//   concatenated names (the string table, each distinct name once).
+//   Numbers use the byte order of the machine that wrote the file.
+struct SnapshotHeader {
+    char magic[8];      // "PLSNAP01"
+    uint64_t count;     // Number of records
+    uint64_t nameBytes; // Size of the string table
+};
+
+struct SnapshotRecord {
+    uint64_t nameOffset;  // Start of the name in the string table
+    uint32_t nameLength;  // Length of the name in bytes
+    int32_t age;          // Person's age
+    double salary;        // Person's salary
+};
+
+static const char SNAPSHOT_MAGIC[8] = {'P', 'L', 'S', 'N', 'A', 'P', '0', '1'};
+
+// Write a list to a snapshot file
+bool saveSnapshot(const PersonList& list, const string& filename) {
+    ofstream outFile(filename, ios::binary);
+    if (!outFile.is_open()) {
+        cerr << "Error: Could not open file for saving: " << filename << endl;
+        return false;
+    }
+
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.count = list.size();
+    header.nameBytes = 0;
+
+    // Every distinct name goes into the string table once
+    const NamePool& names = list.namePool();
+    vector<uint64_t> offsets(names.idLimit(), UINT64_MAX);  // Name id -> offset in the table
+    vector<NameId> tableOrder;                              // Name ids in table order
+    vector<SnapshotRecord> records;
+    records.reserve(list.size());
+    for (const Person& person : list) {
+        const string& name = names.text(person.name);
+        if (offsets[person.name] == UINT64_MAX) {
+            offsets[person.name] = header.nameBytes;
+            header.nameBytes += name.size();
+            tableOrder.push_back(person.name);
         }
+        records.push_back(SnapshotRecord{offsets[person.name], uint32_t(name.size()), person.age, person.salary});
+    }
 
-        // Search for the node before the one to delete
-        Person* temp = head;
-        while (temp->next != nullptr && temp->next->name != targetName) {
-            temp = temp->next;
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(SnapshotRecord));
+    for (NameId id : tableOrder) outFile.write(names.text(id).data(), names.text(id).size());
+
+    if (!outFile) {
+        cerr << "Error: Could not write snapshot: " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// Read-only view of a snapshot file mapped into memory.
+// Names, ages and salaries are served straight from the mapping.
+class PersonSnapshot {
+private:
+    const char* data;      // Start of the mapped file
+    size_t bytes;          // Size of the mapped file
+    const SnapshotRecord* records; // Fixed-width records inside the mapping
+    const char* names;     // String table inside the mapping
+    size_t count;          // Number of records
+#ifdef _WIN32
+    vector<char> buffer;   // Whole file, where mmap is not available
+#endif
+
+    void close() {
+#ifndef _WIN32
+        if (data != nullptr) munmap(const_cast<char*>(data), bytes);
+#endif
+        data = nullptr;
+        bytes = count = 0;
+    }
+
+public:
+    PersonSnapshot() : data(nullptr), bytes(0), records(nullptr), names(nullptr), count(0) {}
+
+    PersonSnapshot(const PersonSnapshot&) = delete;
+    PersonSnapshot& operator=(const PersonSnapshot&) = delete;
+
+    ~PersonSnapshot() { close(); }
+
+    // Map a snapshot file and check that it is well formed
+    bool open(const string& filename) {
+        close();
+#ifdef _WIN32
+        ifstream inFile(filename, ios::binary);
+        if (!inFile.is_open()) {
+            cerr << "Error: Could not open snapshot: " << filename << endl;
+            return false;
         }
+        buffer.assign(istreambuf_iterator<char>(inFile), istreambuf_iterator<char>());
+        data = buffer.data();
+        bytes = buffer.size();
+#else
+        int descriptor = ::open(filename.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            cerr << "Error: Could not open snapshot: " << filename << endl;
+            return false;
+        }
+        struct stat status;
+        if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+            void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (mapping != MAP_FAILED) {
+                data = static_cast<const char*>(mapping);
+                bytes = status.st_size;
+                madvise(mapping, bytes, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(descriptor);
+#endif
 
-        if (temp->next != nullptr) {
-            // Target found, delete it
-            Person* nodeToDelete = temp->next;
-            temp->next = temp->next->next;
-            delete nodeToDelete;
+        SnapshotHeader header;
+        if (data == nullptr || bytes < sizeof(header)) {
+            cerr << "Error: Snapshot is missing or truncated: " << filename << endl;
+            close();
+            return false;
         }
-        else {
-            cout << "Person with the name " << targetName << " not found." << endl;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+            header.count > (bytes - sizeof(header)) / sizeof(SnapshotRecord) ||
+            header.nameBytes != bytes - sizeof(header) - header.count * sizeof(SnapshotRecord)) {
+            cerr << "Error: Not a valid snapshot: " << filename << endl;
+            close();
+            return false;
         }
-    }
 
-    // Print the entire list
-    void printList() const {
-        Person* temp = head;
-        while (temp != nullptr) {
-            cout << "Name: " << temp->name
-                 << ", Age: " << temp->age
-                 << ", Salary: " << temp->salary << endl;
-            temp = temp->next;
+        count = header.count;
+        records = reinterpret_cast<const SnapshotRecord*>(data + sizeof(header));
+        names = data + sizeof(header) + count * sizeof(SnapshotRecord);
+        for (size_t i = 0; i < count; i++) {
+            // Compared without adding, so a huge offset cannot wrap around and pass
+            if (records[i].nameOffset > header.nameBytes ||
+                records[i].nameLength > header.nameBytes - records[i].nameOffset) {
+                cerr << "Error: Name out of range in snapshot: " << filename << endl;
+                close();
+                return false;
+            }
         }
+        return true;
+    }
+
+    size_t size() const { return count; }
+    string_view nameAt(size_t i) const { return string_view(names + records[i].nameOffset, records[i].nameLength); }
+    int ageAt(size_t i) const { return records[i].age; }
+    double salaryAt(size_t i) const { return records[i].salary; }
+
+    // Append every person of the snapshot to a list in one pass
+    void appendTo(PersonList& list) const {
+        list.reserve(count);
+        for (size_t i = 0; i < count; i++) list.addToEnd(nameAt(i), ageAt(i), salaryAt(i));
+    }
+};
+
+// Seconds spent running work once
+template <class Work>
+double timeSeconds(Work work) {
+    auto start = chrono::steady_clock::now();
+    work();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Compare traversal and linear name search of the one-node-per-person layout
+// (pooled and heap-allocated) with the unrolled layout. Prints CSV.
+void runUnrolledBenchmark(size_t peopleCount) {
+    const int SEARCHES = 200;
+    const int TRAVERSALS = 5;
+
+    PersonList pooled(NodeAllocation::Pool);
+    PersonList heap(NodeAllocation::Heap);
+    UnrolledPersonList unrolled;
+    for (size_t i = 0; i < peopleCount; i++) {
+        string name = "Person" + to_string(i);
+        pooled.addToEnd(name, 20 + i % 50, 1000.0 * (i % 97));
+        heap.addToEnd(name, 20 + i % 50, 1000.0 * (i % 97));
+        unrolled.addToEnd(std::move(name), 20 + i % 50, 1000.0 * (i % 97));
+    }
+
+    // The same pseudo-random names are searched in every layout
+    vector<string> targets;
+    mt19937 random(7);
+    for (int i = 0; i < SEARCHES; i++) targets.push_back("Person" + to_string(random() % peopleCount));
+
+    cout << "layout,people,operation,ns_per_person_visited,checksum" << endl;
+    auto report = [peopleCount](const char* layout, const char* operation, double seconds, double visited, double checksum) {
+        cout << layout << "," << peopleCount << "," << operation << "," << seconds * 1e9 / visited << "," << checksum << endl;
+    };
+
+    for (int layout = 0; layout < 3; layout++) {
+        const char* layoutName = layout == 0 ? "node-pool" : layout == 1 ? "node-heap" : "unrolled";
+        const PersonList& list = layout == 0 ? pooled : heap;
+
+        double total = 0;
+        double seconds = timeSeconds([&]() {
+            for (int pass = 0; pass < TRAVERSALS; pass++) {
+                if (layout < 2) list.forEach([&total](const Person& person) { total += person.salary; });
+                else unrolled.forEach([&total](const PersonRecord& person) { total += person.salary; });
+            }
+        });
+        report(layoutName, "traverse", seconds, double(TRAVERSALS) * peopleCount, total);
+
+        // Linear scans; PersonList::find would use the hash index instead
+        double ages = 0;
+        seconds = timeSeconds([&]() {
+            for (const string& target : targets) {
+                if (layout < 2) {
+                    ages += find_if(list.begin(), list.end(), [&list, &target](const Person& person) { return list.nameOf(person) == target; })->age;
+                }
+                else {
+                    ages += unrolled.find(target)->age;
+                }
+            }
+        });
+
+        // "PersonN" sits at position N, so a search for it visits N + 1 people
+        double visited = 0;
+        for (const string& target : targets) visited += stoul(target.substr(6)) + 1;
+        report(layoutName, "linear-search", seconds, visited, ages);
+    }
+}
+
+// Time writing a snapshot, rebuilding a list from it and scanning it in place
+void runSnapshotBenchmark(size_t peopleCount, const string& filename) {
+    PersonList list;
+    for (size_t i = 0; i < peopleCount; i++) list.addToEnd("Person" + to_string(i), 20 + i % 50, 1000.0 * (i % 97));
+
+    cout << "operation,people,seconds" << endl;
+    cout << "save," << peopleCount << "," << timeSeconds([&]() { saveSnapshot(list, filename); }) << endl;
+
+    PersonSnapshot snapshot;
+    cout << "map," << peopleCount << "," << timeSeconds([&]() { snapshot.open(filename); }) << endl;
+
+    double total = 0;
+    double scanSeconds = timeSeconds([&]() {
+        for (size_t i = 0; i < snapshot.size(); i++) total += snapshot.salaryAt(i) + snapshot.nameAt(i).size();
+    });
+    cout << "scan-mapped," << peopleCount << "," << scanSeconds << endl;
+
+    PersonList loaded;
+    cout << "rebuild-list," << peopleCount << "," << timeSeconds([&]() { snapshot.appendTo(loaded); }) << endl;
+
+    if (loaded.size() != list.size() || !equal(list.begin(), list.end(), loaded.begin(),
+            [&](const Person& a, const Person& b) { return list.nameOf(a) == loaded.nameOf(b) && a.age == b.age && a.salary == b.salary; })) {
+        cerr << "Error: Reloaded list differs from the original" << endl;
+    }
+    if (total < 0) cout << total << endl;  // Keep the scan from being optimized away
+    remove(filename.c_str());
+}
+
+// Report how much memory per person name interning saves for a list with
+// peopleCount people sharing distinctNames names
+void runNameInterningReport(size_t peopleCount, size_t distinctNames) {
+    // Layout Person would have with its own string instead of a handle
+    struct PersonWithString : ListHook<PersonWithString> {
+        string name;
+        int age;
+        double salary;
+        PersonWithString* nextSameName;
+        PersonWithString* prevSameName;
+        unsigned long long order;
+    };
+
+    PersonList list;
+    double stringHeapBytes = 0;  // What each node's own string would allocate
+    size_t inlineCapacity = string().capacity();
+    for (size_t i = 0; i < peopleCount; i++) {
+        string name = "Employee name #" + to_string(i % distinctNames);
+        if (name.size() > inlineCapacity) stringHeapBytes += name.size() + 1;
+        list.addToEnd(name, 20 + i % 50, 1000.0 * (i % 97));
+    }
+
+    double before = sizeof(PersonWithString) + stringHeapBytes / peopleCount;
+    double after = sizeof(Person) + double(list.namePool().bytes()) / peopleCount;
+    cout << "people,distinct_names,bytes_per_node_string,bytes_per_node_interned,saved_per_node" << endl;
+    cout << peopleCount << "," << list.namePool().size() << "," << before << "," << after << "," << before - after << endl;
+}
+
+// Allocation counting for the benchmark suite, chosen at compile time with
+// -DLAB1_COUNT_ALLOCATIONS=1. Counting needs replacements of the global operator
+// new and delete, which would affect the whole program, so normal builds leave
+// the standard ones in place and the suite reports allocations as "n/a".
+#ifndef LAB1_COUNT_ALLOCATIONS
+#define LAB1_COUNT_ALLOCATIONS 0
+#endif
+
+#if LAB1_COUNT_ALLOCATIONS
+// Number of heap allocations made through operator new
+static atomic<unsigned long long> allocationCount(0);
+
+// Counting replacements of the global allocation functions; the array forms
+// forward to these. GCC cannot see that new and delete here pair malloc with free.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* memory = malloc(size != 0 ? size : 1)) return memory;
+    throw bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+// Largest resident set size of the process so far, in kilobytes
+long peakRssKilobytes() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // Reported in bytes there
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// PersonList behind the interface shared by the benchmark suite
+class PersonListBenchmark {
+private:
+    PersonList list;
+
+public:
+    explicit PersonListBenchmark(NodeAllocation allocation) : list(allocation) {}
+
+    void addToEnd(const string& name, int age, double salary) { list.addToEnd(name, age, salary); }
+    void addToBeginning(const string& name, int age, double salary) { list.addToBeginning(name, age, salary); }
+    void addAfter(const string& target, const string& name, int age, double salary) { list.addAfter(target, name, age, salary); }
+    void addBefore(const string& target, const string& name, int age, double salary) { list.addBefore(target, name, age, salary); }
+    void deleteByName(const string& target) { list.deleteByName(target); }
+    bool find(const string& target) const { return list.find(target) != nullptr; }
+
+    double traverse() const {
+        double total = 0;
+        list.forEach([&total](const Person& person) { total += person.salary; });
+        return total;
+    }
+
+    // Every operation finds its target through the name index
+    static bool scansFor(const string&) { return false; }
+};
+
+// std::list or std::vector of PersonRecord behind the same interface
+template <class Container>
+class StandardBenchmark {
+private:
+    Container people;
+
+    typename Container::iterator locate(const string& target) {
+        return find_if(people.begin(), people.end(), [&target](const PersonRecord& person) { return person.name == target; });
+    }
+
+public:
+    void addToEnd(const string& name, int age, double salary) { people.push_back(PersonRecord{name, age, salary}); }
+    void addToBeginning(const string& name, int age, double salary) { people.insert(people.begin(), PersonRecord{name, age, salary}); }
+
+    void addAfter(const string& target, const string& name, int age, double salary) {
+        auto found = locate(target);
+        if (found != people.end()) people.insert(next(found), PersonRecord{name, age, salary});
+    }
+
+    void addBefore(const string& target, const string& name, int age, double salary) {
+        auto found = locate(target);
+        if (found != people.end()) people.insert(found, PersonRecord{name, age, salary});
+    }
+
+    void deleteByName(const string& target) {
+        auto found = locate(target);
+        if (found != people.end()) people.erase(found);
+    }
+
+    bool find(const string& target) const {
+        return any_of(people.begin(), people.end(), [&target](const PersonRecord& person) { return person.name == target; });
+    }
+
+    double traverse() const {
+        double total = 0;
+        for (const PersonRecord& person : people) total += person.salary;
+        return total;
+    }
+
+    // Name searches are linear, and so is inserting at the front of a vector
+    static bool scansFor(const string& operation) {
+        if (operation == "addToBeginning") return is_same<Container, vector<PersonRecord>>::value;
+        return operation != "addToEnd" && operation != "traverse";
     }
 };
 
+// Name of the i-th benchmark person, written into a reused buffer
+void benchmarkName(string& buffer, size_t i) {
+    buffer.assign("Person");
+    buffer += to_string(i);
+}
+
+// Run every operation on one structure holding peopleCount people and
+// print one CSV line per operation
+template <class Structure>
+void benchmarkStructure(const char* label, Structure& structure, size_t peopleCount) {
+    const size_t FAST_OPERATIONS = 100000;  // Operations timed when each is O(1)
+    const size_t SCAN_BUDGET = 20000000;    // People visited at most by scanning operations
+
+    auto operationsFor = [&](const string& operation) {
+        size_t operations = min(peopleCount, FAST_OPERATIONS);
+        if (Structure::scansFor(operation)) operations = max<size_t>(1, min(operations, SCAN_BUDGET / peopleCount));
+        return operations;
+    };
+
+    auto run = [&](const string& operation, size_t operations, function<void()> work) {
+#if LAB1_COUNT_ALLOCATIONS
+        unsigned long long allocationsBefore = allocationCount.load();
+#endif
+        double seconds = timeSeconds(work);
+        cout << label << "," << operation << "," << peopleCount << "," << operations << ","
+             << seconds * 1e9 / operations << ",";
+#if LAB1_COUNT_ALLOCATIONS
+        cout << double(allocationCount.load() - allocationsBefore) / operations;
+#else
+        cout << "n/a";
+#endif
+        cout << "," << peakRssKilobytes() << endl;
+    };
+
+    string name, target;
+    mt19937_64 random(peopleCount);
+
+    run("addToEnd", peopleCount, [&]() {
+        for (size_t i = 0; i < peopleCount; i++) {
+            benchmarkName(name, i);
+            structure.addToEnd(name, 20 + i % 50, 1000.0 * (i % 97));
+        }
+    });
+
+    double total = 0;
+    run("traverse", peopleCount, [&]() { total = structure.traverse(); });
+
+    size_t operations = operationsFor("find");
+    size_t found = 0;
+    run("find", operations, [&]() {
+        for (size_t i = 0; i < operations; i++) {
+            benchmarkName(target, random() % peopleCount);
+            found += structure.find(target);
+        }
+    });
+
+    // Newly added people get numbers above the original ones
+    size_t nextNumber = peopleCount;
+    const char* insertions[] = {"addToBeginning", "addAfter", "addBefore"};
+    for (int kind = 0; kind < 3; kind++) {
+        operations = operationsFor(insertions[kind]);
+        run(insertions[kind], operations, [&]() {
+            for (size_t i = 0; i < operations; i++) {
+                benchmarkName(name, nextNumber++);
+                benchmarkName(target, random() % peopleCount);
+                if (kind == 0) structure.addToBeginning(name, 30, 1000);
+                else if (kind == 1) structure.addAfter(target, name, 30, 1000);
+                else structure.addBefore(target, name, 30, 1000);
+            }
+        });
+    }
+
+    // Delete distinct original people, picked at random
+    operations = operationsFor("deleteByName");
+    vector<size_t> victims;
+    for (size_t i = 0; i < operations; i++) victims.push_back(random() % peopleCount);
+    sort(victims.begin(), victims.end());
+    victims.erase(unique(victims.begin(), victims.end()), victims.end());
+    shuffle(victims.begin(), victims.end(), random);
+    run("deleteByName", victims.size(), [&]() {
+        for (size_t victim : victims) {
+            benchmarkName(target, victim);
+            structure.deleteByName(target);
+        }
+    });
+
+    if (found > operations + peopleCount || total < 0) cout << found << total << endl;  // Keep results alive
+}
+
+// Benchmark suite: every PersonList operation on 1K..maxPeople people, next to
+// std::list and std::vector baselines. Prints CSV on standard output.
+// peak_rss_kb is the process peak so far; sizes run in ascending order.
+// allocations_per_op needs a build with -DLAB1_COUNT_ALLOCATIONS=1.
+void runBenchmarkSuite(size_t maxPeople) {
+    cout << "structure,operation,people,operations,ns_per_op,allocations_per_op,peak_rss_kb" << endl;
+    for (size_t people = 1000; people <= maxPeople; people *= 10) {
+        {
+            PersonListBenchmark pooled(NodeAllocation::Pool);
+            benchmarkStructure("PersonList(pool)", pooled, people);
+        }
+        {
+            PersonListBenchmark heap(NodeAllocation::Heap);
+            benchmarkStructure("PersonList(heap)", heap, people);
+        }
+        {
+            StandardBenchmark<list<PersonRecord>> linked;
+            benchmarkStructure("std::list", linked, people);
+        }
+        {
+            StandardBenchmark<vector<PersonRecord>> contiguous;
+            benchmarkStructure("std::vector", contiguous, people);
+        }
+    }
+}
+
 // Main function
-int main() {
+int main(int argc, char* argv[]) {
+    // Optional modes: "stress [threads]", "bench-concurrent [max threads]"
+    // "bench-unrolled [people]", "bench-snapshot [people]", "names-report [people] [names]"
+    // and "bench [max people]" for the whole benchmark suite
+    if (argc > 1) {
+        string mode = argv[1];
+        if (mode == "bench") {
+            runBenchmarkSuite(argc > 2 ? stoul(argv[2]) : 10000000);
+            return 0;
+        }
+        if (mode == "stress" || mode == "bench-concurrent") {
+            int threads = argc > 2 ? stoi(argv[2]) : max(2, (int)thread::hardware_concurrency());
+            if (mode == "stress") return runConcurrentStressTest(threads, 3000);
+            runConcurrentBenchmark(threads, 20000);
+            return 0;
+        }
+        if (mode == "bench-unrolled") {
+            runUnrolledBenchmark(argc > 2 ? stoul(argv[2]) : 1000000);
+            return 0;
+        }
+        if (mode == "names-report") {
+            runNameInterningReport(argc > 2 ? stoul(argv[2]) : 1000000, argc > 3 ? stoul(argv[3]) : 1000);
+            return 0;
+        }
+        if (mode == "bench-snapshot") {
+            runSnapshotBenchmark(argc > 2 ? stoul(argv[2]) : 10000000, "people.snapshot");
+            return 0;
+        }
+        cerr << "Unknown mode " << mode << endl;
+        return 1;
+    }
+
     PersonList list;  // Create a list of persons
 
     // Add persons to the list
@@ -181,5 +2361,34 @@ int main() {
     cout << "\nList after deleting Anton:" << endl;
     list.printList();
 
+    // The list works with the standard algorithms
+    long under30 = count_if(list.begin(), list.end(), [](const Person& person) { return person.age < 30; });
+    cout << "\nPeople under 30: " << under30 << endl;
+
+    // Range and top-N queries through the ordered salary index
+    list.enableSalaryIndex();
+    cout << "Earning between 40000 and 60000:" << endl;
+    list.forEachSalaryBetween(40000, 60000, [&list](const Person& person) {
+        cout << "Name: " << list.nameOf(person) << ", Salary: " << person.salary << endl;
+    });
+    cout << "Top 2 by salary:";
+    for (const Person* person : list.topBySalary(2)) cout << " " << list.nameOf(*person);
+    cout << "\nPeople earning less than 45000: " << list.salaryRank(45000) << endl;
+
+    // Payroll analytics over a columnar copy of the list
+    PersonStore store = PersonStore::fromList(list);
+    SalaryStats payroll = store.salaryStats();
+    cout << "\nPayroll: total " << payroll.sum << ", min " << payroll.min
+         << ", max " << payroll.max << ", mean " << payroll.mean() << endl;
+
+    Selection young = store.selectAgeRange(20, 25);
+    cout << "Aged 20-25: " << young.count() << " people, mean salary "
+         << store.salaryStats(young).mean() << endl;
+
+    for (const auto& band : store.salaryByAgeBand(10)) {
+        cout << "Ages " << band.first << "-" << band.first + 9 << ": "
+             << band.second.count << " people, mean salary " << band.second.mean() << endl;
+    }
+
     return 0;
 }
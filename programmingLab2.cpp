@@ -1,19 +1,624 @@
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <type_traits>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <limits>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
+// Runtime-dispatched SIMD kernels are built with GCC/Clang target attributes on x86;
+// other compilers and architectures use the scalar kernels only.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Matrices per group of a batch (see matrbatch): element (i, j) of the group's
+// matrices is stored as BATCH_LANES consecutive doubles, one per matrix
+const int BATCH_LANES = 8;
+
+// Block sizes of the matrix multiplication kernel
+const int GEMM_MR = 4;    // Rows of C computed at once by the micro-kernel
+const int GEMM_NR = 8;    // Columns of C computed at once by the micro-kernel
+const int GEMM_KC = 256;  // Depth of a packed panel (A sliver + B sliver stay in L1)
+const int GEMM_MC = 96;   // Rows of a packed block of A (kept in L2)
+const int GEMM_NC = 2048; // Columns of a packed block of B (kept in L3)
+
+// Element-wise kernels for one instruction set
+struct SimdKernels {
+    const char* name;  // Instruction set: "scalar", "sse2", "avx2" or "avx512"
+    void (*add)(const double* x, const double* y, double* out, int count);   // out = x + y
+    void (*sub)(const double* x, const double* y, double* out, int count);   // out = x - y
+    void (*neg)(const double* x, double* out, int count);                    // out = -x
+    void (*scale)(double k, const double* x, double* out, int count);        // out = k * x
+    double (*dot)(const double* x, const double* y, int count);              // sum of x * y
+    // C = A * B for one group of BATCH_LANES interleaved rows x depth and depth x cols matrices
+    void (*batchGemm)(int rows, int depth, int cols, const double* A, const double* B, double* C);
+    // C[rows x cols] += alpha * (A sliver) * (B sliver) for packed GEMM_MR x kc and kc x GEMM_NR
+    // slivers; rows <= GEMM_MR and cols <= GEMM_NR trim the edge tiles
+    void (*gemmKernel)(int kc, double alpha, const double* a, const double* b,
+                       double* C, int ldc, int rows, int cols);
+};
+
+static void scalarAdd(const double* x, const double* y, double* out, int count) {
+    for (int i = 0; i < count; i++) out[i] = x[i] + y[i];
+}
+static void scalarSub(const double* x, const double* y, double* out, int count) {
+    for (int i = 0; i < count; i++) out[i] = x[i] - y[i];
+}
+static void scalarNeg(const double* x, double* out, int count) {
+    for (int i = 0; i < count; i++) out[i] = -x[i];
+}
+static void scalarScale(double k, const double* x, double* out, int count) {
+    for (int i = 0; i < count; i++) out[i] = k * x[i];
+}
+static double scalarDot(const double* x, const double* y, int count) {
+    double res = 0;
+    for (int i = 0; i < count; i++) res += x[i] * y[i];
+    return res;
+}
+static void scalarBatchGemm(int rows, int depth, int cols, const double* A, const double* B, double* C) {
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++) {
+            double acc[BATCH_LANES] = {};
+            for (int k = 0; k < depth; k++) {
+                const double* a = A + (i * depth + k) * BATCH_LANES;
+                const double* b = B + (k * cols + j) * BATCH_LANES;
+                for (int l = 0; l < BATCH_LANES; l++) acc[l] += a[l] * b[l];
+            }
+            for (int l = 0; l < BATCH_LANES; l++) C[(i * cols + j) * BATCH_LANES + l] = acc[l];
+        }
+}
+// Add a GEMM_MR x GEMM_NR tile of products to the rows x cols corner of C
+static void addGemmTile(const double (&acc)[GEMM_MR][GEMM_NR], double alpha, double* C, int ldc, int rows, int cols) {
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            C[i * ldc + j] += alpha * acc[i][j];
+}
+static void scalarGemmKernel(int kc, double alpha, const double* a, const double* b,
+                             double* C, int ldc, int rows, int cols) {
+    double acc[GEMM_MR][GEMM_NR] = {};
+    for (int p = 0; p < kc; p++) {
+        for (int i = 0; i < GEMM_MR; i++) {
+            double ai = a[p * GEMM_MR + i];
+            for (int j = 0; j < GEMM_NR; j++) acc[i][j] += ai * b[p * GEMM_NR + j];
+        }
+    }
+    addGemmTile(acc, alpha, C, ldc, rows, cols);
+}
+
+#ifdef SIMD_X86
+// SSE2: two doubles per register
+__attribute__((target("sse2"))) static void sse2Add(const double* x, const double* y, double* out, int count) {
+    int i = 0;
+    for (; i + 2 <= count; i += 2) _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    for (; i < count; i++) out[i] = x[i] + y[i];
+}
+__attribute__((target("sse2"))) static void sse2Sub(const double* x, const double* y, double* out, int count) {
+    int i = 0;
+    for (; i + 2 <= count; i += 2) _mm_storeu_pd(out + i, _mm_sub_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    for (; i < count; i++) out[i] = x[i] - y[i];
+}
+__attribute__((target("sse2"))) static void sse2Neg(const double* x, double* out, int count) {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) _mm_storeu_pd(out + i, _mm_xor_pd(_mm_loadu_pd(x + i), sign));
+    for (; i < count; i++) out[i] = -x[i];
+}
+__attribute__((target("sse2"))) static void sse2Scale(double k, const double* x, double* out, int count) {
+    const __m128d factor = _mm_set1_pd(k);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) _mm_storeu_pd(out + i, _mm_mul_pd(factor, _mm_loadu_pd(x + i)));
+    for (; i < count; i++) out[i] = k * x[i];
+}
+__attribute__((target("sse2"))) static double sse2Dot(const double* x, const double* y, int count) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();  // Two chains hide add latency
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    double res = lanes[0] + lanes[1];
+    for (; i < count; i++) res += x[i] * y[i];
+    return res;
+}
+
+// AVX2 (with FMA for the dot product): four doubles per register
+__attribute__((target("avx2"))) static void avx2Add(const double* x, const double* y, double* out, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    for (; i < count; i++) out[i] = x[i] + y[i];
+}
+__attribute__((target("avx2"))) static void avx2Sub(const double* x, const double* y, double* out, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) _mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    for (; i < count; i++) out[i] = x[i] - y[i];
+}
+__attribute__((target("avx2"))) static void avx2Neg(const double* x, double* out, int count) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) _mm256_storeu_pd(out + i, _mm256_xor_pd(_mm256_loadu_pd(x + i), sign));
+    for (; i < count; i++) out[i] = -x[i];
+}
+__attribute__((target("avx2"))) static void avx2Scale(double k, const double* x, double* out, int count) {
+    const __m256d factor = _mm256_set1_pd(k);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) _mm256_storeu_pd(out + i, _mm256_mul_pd(factor, _mm256_loadu_pd(x + i)));
+    for (; i < count; i++) out[i] = k * x[i];
+}
+__attribute__((target("avx2,fma"))) static double avx2Dot(const double* x, const double* y, int count) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), acc1);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    double res = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < count; i++) res += x[i] * y[i];
+    return res;
+}
+__attribute__((target("avx2,fma"))) static void avx2BatchGemm(int rows, int depth, int cols, const double* A,
+                                                                const double* B, double* C) {
+    for (int i = 0; i < rows; i++) {
+        const double* rowA = A + i * depth * BATCH_LANES;
+        double* rowC = C + i * cols * BATCH_LANES;
+        int j = 0;
+        for (; j + 2 <= cols; j += 2) {  // Two columns, four independent accumulator chains
+            __m256d c0 = _mm256_setzero_pd(), c1 = _mm256_setzero_pd();  // Column j, lanes 0-3 and 4-7
+            __m256d c2 = _mm256_setzero_pd(), c3 = _mm256_setzero_pd();  // Column j + 1
+            for (int k = 0; k < depth; k++) {
+                const double* a = rowA + k * BATCH_LANES;
+                const double* b = B + (k * cols + j) * BATCH_LANES;
+                __m256d a0 = _mm256_loadu_pd(a), a1 = _mm256_loadu_pd(a + 4);
+                c0 = _mm256_fmadd_pd(a0, _mm256_loadu_pd(b), c0);
+                c1 = _mm256_fmadd_pd(a1, _mm256_loadu_pd(b + 4), c1);
+                c2 = _mm256_fmadd_pd(a0, _mm256_loadu_pd(b + BATCH_LANES), c2);
+                c3 = _mm256_fmadd_pd(a1, _mm256_loadu_pd(b + BATCH_LANES + 4), c3);
+            }
+            _mm256_storeu_pd(rowC + j * BATCH_LANES, c0);
+            _mm256_storeu_pd(rowC + j * BATCH_LANES + 4, c1);
+            _mm256_storeu_pd(rowC + (j + 1) * BATCH_LANES, c2);
+            _mm256_storeu_pd(rowC + (j + 1) * BATCH_LANES + 4, c3);
+        }
+        for (; j < cols; j++) {
+            __m256d c0 = _mm256_setzero_pd(), c1 = _mm256_setzero_pd();
+            for (int k = 0; k < depth; k++) {
+                const double* a = rowA + k * BATCH_LANES;
+                const double* b = B + (k * cols + j) * BATCH_LANES;
+                c0 = _mm256_fmadd_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b), c0);
+                c1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + 4), _mm256_loadu_pd(b + 4), c1);
+            }
+            _mm256_storeu_pd(rowC + j * BATCH_LANES, c0);
+            _mm256_storeu_pd(rowC + j * BATCH_LANES + 4, c1);
+        }
+    }
+}
+// 4x8 tile in eight registers: each B row is two loads, each A element one broadcast
+__attribute__((target("avx2,fma"))) static void avx2GemmKernel(int kc, double alpha, const double* a, const double* b,
+                                                                 double* C, int ldc, int rows, int cols) {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd(), c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd(), c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+    for (int p = 0; p < kc; p++, a += GEMM_MR, b += GEMM_NR) {
+        __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+        __m256d ai = _mm256_broadcast_sd(a);
+        c00 = _mm256_fmadd_pd(ai, b0, c00); c01 = _mm256_fmadd_pd(ai, b1, c01);
+        ai = _mm256_broadcast_sd(a + 1);
+        c10 = _mm256_fmadd_pd(ai, b0, c10); c11 = _mm256_fmadd_pd(ai, b1, c11);
+        ai = _mm256_broadcast_sd(a + 2);
+        c20 = _mm256_fmadd_pd(ai, b0, c20); c21 = _mm256_fmadd_pd(ai, b1, c21);
+        ai = _mm256_broadcast_sd(a + 3);
+        c30 = _mm256_fmadd_pd(ai, b0, c30); c31 = _mm256_fmadd_pd(ai, b1, c31);
+    }
+    __m256d acc[GEMM_MR][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}};
+    if (rows == GEMM_MR && cols == GEMM_NR) {
+        const __m256d factor = _mm256_set1_pd(alpha);
+        for (int i = 0; i < GEMM_MR; i++) {
+            double* row = C + i * ldc;
+            _mm256_storeu_pd(row, _mm256_fmadd_pd(factor, acc[i][0], _mm256_loadu_pd(row)));
+            _mm256_storeu_pd(row + 4, _mm256_fmadd_pd(factor, acc[i][1], _mm256_loadu_pd(row + 4)));
+        }
+        return;
+    }
+    double tile[GEMM_MR][GEMM_NR];
+    for (int i = 0; i < GEMM_MR; i++) {
+        _mm256_storeu_pd(tile[i], acc[i][0]);
+        _mm256_storeu_pd(tile[i] + 4, acc[i][1]);
+    }
+    addGemmTile(tile, alpha, C, ldc, rows, cols);
+}
+
+// AVX-512: eight doubles per register
+__attribute__((target("avx512f"))) static void avx512Add(const double* x, const double* y, double* out, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) _mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    for (; i < count; i++) out[i] = x[i] + y[i];
+}
+__attribute__((target("avx512f"))) static void avx512Sub(const double* x, const double* y, double* out, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) _mm512_storeu_pd(out + i, _mm512_sub_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    for (; i < count; i++) out[i] = x[i] - y[i];
+}
+__attribute__((target("avx512f"))) static void avx512Neg(const double* x, double* out, int count) {
+    const __m512i sign = _mm512_set1_epi64((long long)0x8000000000000000ULL);  // Flip only the sign bit
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm512_storeu_pd(out + i, _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(_mm512_loadu_pd(x + i)), sign)));
+    for (; i < count; i++) out[i] = -x[i];
+}
+__attribute__((target("avx512f"))) static void avx512Scale(double k, const double* x, double* out, int count) {
+    const __m512d factor = _mm512_set1_pd(k);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) _mm512_storeu_pd(out + i, _mm512_mul_pd(factor, _mm512_loadu_pd(x + i)));
+    for (; i < count; i++) out[i] = k * x[i];
+}
+__attribute__((target("avx512f"))) static double avx512Dot(const double* x, const double* y, int count) {
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), acc1);
+    }
+    double lanes[8];
+    _mm512_storeu_pd(lanes, _mm512_add_pd(acc0, acc1));
+    double res = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    for (; i < count; i++) res += x[i] * y[i];
+    return res;
+}
+__attribute__((target("avx512f"))) static void avx512BatchGemm(int rows, int depth, int cols, const double* A,
+                                                                 const double* B, double* C) {
+    for (int i = 0; i < rows; i++) {
+        const double* rowA = A + i * depth * BATCH_LANES;
+        double* rowC = C + i * cols * BATCH_LANES;
+        int j = 0;
+        for (; j + 4 <= cols; j += 4) {  // Four columns, four independent accumulator chains
+            __m512d c0 = _mm512_setzero_pd(), c1 = _mm512_setzero_pd();
+            __m512d c2 = _mm512_setzero_pd(), c3 = _mm512_setzero_pd();
+            for (int k = 0; k < depth; k++) {
+                __m512d a = _mm512_loadu_pd(rowA + k * BATCH_LANES);  // One lane per matrix of the group
+                const double* b = B + (k * cols + j) * BATCH_LANES;
+                c0 = _mm512_fmadd_pd(a, _mm512_loadu_pd(b), c0);
+                c1 = _mm512_fmadd_pd(a, _mm512_loadu_pd(b + BATCH_LANES), c1);
+                c2 = _mm512_fmadd_pd(a, _mm512_loadu_pd(b + 2 * BATCH_LANES), c2);
+                c3 = _mm512_fmadd_pd(a, _mm512_loadu_pd(b + 3 * BATCH_LANES), c3);
+            }
+            _mm512_storeu_pd(rowC + j * BATCH_LANES, c0);
+            _mm512_storeu_pd(rowC + (j + 1) * BATCH_LANES, c1);
+            _mm512_storeu_pd(rowC + (j + 2) * BATCH_LANES, c2);
+            _mm512_storeu_pd(rowC + (j + 3) * BATCH_LANES, c3);
+        }
+        for (; j < cols; j++) {
+            __m512d c0 = _mm512_setzero_pd();
+            for (int k = 0; k < depth; k++)
+                c0 = _mm512_fmadd_pd(_mm512_loadu_pd(rowA + k * BATCH_LANES),
+                                     _mm512_loadu_pd(B + (k * cols + j) * BATCH_LANES), c0);
+            _mm512_storeu_pd(rowC + j * BATCH_LANES, c0);
+        }
+    }
+}
+// 4x8 tile with one register per row; even and odd steps of kc go to separate
+// accumulators so eight fused multiply-add chains are in flight
+__attribute__((target("avx512f"))) static void avx512GemmKernel(int kc, double alpha, const double* a, const double* b,
+                                                                  double* C, int ldc, int rows, int cols) {
+    __m512d c0 = _mm512_setzero_pd(), c1 = _mm512_setzero_pd(), c2 = _mm512_setzero_pd(), c3 = _mm512_setzero_pd();
+    __m512d d0 = _mm512_setzero_pd(), d1 = _mm512_setzero_pd(), d2 = _mm512_setzero_pd(), d3 = _mm512_setzero_pd();
+    int p = 0;
+    for (; p + 2 <= kc; p += 2, a += 2 * GEMM_MR, b += 2 * GEMM_NR) {
+        __m512d b0 = _mm512_loadu_pd(b), b1 = _mm512_loadu_pd(b + GEMM_NR);
+        c0 = _mm512_fmadd_pd(_mm512_set1_pd(a[0]), b0, c0);
+        c1 = _mm512_fmadd_pd(_mm512_set1_pd(a[1]), b0, c1);
+        c2 = _mm512_fmadd_pd(_mm512_set1_pd(a[2]), b0, c2);
+        c3 = _mm512_fmadd_pd(_mm512_set1_pd(a[3]), b0, c3);
+        d0 = _mm512_fmadd_pd(_mm512_set1_pd(a[4]), b1, d0);
+        d1 = _mm512_fmadd_pd(_mm512_set1_pd(a[5]), b1, d1);
+        d2 = _mm512_fmadd_pd(_mm512_set1_pd(a[6]), b1, d2);
+        d3 = _mm512_fmadd_pd(_mm512_set1_pd(a[7]), b1, d3);
+    }
+    if (p < kc) {
+        __m512d b0 = _mm512_loadu_pd(b);
+        c0 = _mm512_fmadd_pd(_mm512_set1_pd(a[0]), b0, c0);
+        c1 = _mm512_fmadd_pd(_mm512_set1_pd(a[1]), b0, c1);
+        c2 = _mm512_fmadd_pd(_mm512_set1_pd(a[2]), b0, c2);
+        c3 = _mm512_fmadd_pd(_mm512_set1_pd(a[3]), b0, c3);
+    }
+    __m512d acc[GEMM_MR] = {_mm512_add_pd(c0, d0), _mm512_add_pd(c1, d1), _mm512_add_pd(c2, d2), _mm512_add_pd(c3, d3)};
+    if (rows == GEMM_MR && cols == GEMM_NR) {
+        const __m512d factor = _mm512_set1_pd(alpha);
+        for (int i = 0; i < GEMM_MR; i++) {
+            double* row = C + i * ldc;
+            _mm512_storeu_pd(row, _mm512_fmadd_pd(factor, acc[i], _mm512_loadu_pd(row)));
+        }
+        return;
+    }
+    double tile[GEMM_MR][GEMM_NR];
+    for (int i = 0; i < GEMM_MR; i++) _mm512_storeu_pd(tile[i], acc[i]);
+    addGemmTile(tile, alpha, C, ldc, rows, cols);
+}
+#endif
+
+// Every kernel set, from the plainest to the widest
+static const SimdKernels SIMD_KERNELS[] = {
+    {"scalar", scalarAdd, scalarSub, scalarNeg, scalarScale, scalarDot, scalarBatchGemm, scalarGemmKernel},
+#ifdef SIMD_X86
+    // No separate SSE2 batch or GEMM kernels
+    {"sse2", sse2Add, sse2Sub, sse2Neg, sse2Scale, sse2Dot, scalarBatchGemm, scalarGemmKernel},
+    {"avx2", avx2Add, avx2Sub, avx2Neg, avx2Scale, avx2Dot, avx2BatchGemm, avx2GemmKernel},
+    {"avx512", avx512Add, avx512Sub, avx512Neg, avx512Scale, avx512Dot, avx512BatchGemm, avx512GemmKernel},
+#endif
+};
+
+// Whether the running CPU can execute a kernel set
+static bool simdSupported(const SimdKernels& kernels) {
+    string name = kernels.name;
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (name == "sse2") return __builtin_cpu_supports("sse2");
+    if (name == "avx2") return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (name == "avx512") return __builtin_cpu_supports("avx512f");
+#endif
+    return name == "scalar";
+}
+
+// Kernel sets the running CPU supports
+static vector<const SimdKernels*> supportedSimdKernels() {
+    vector<const SimdKernels*> supported;
+    for (const SimdKernels& kernels : SIMD_KERNELS) {
+        if (simdSupported(kernels)) supported.push_back(&kernels);
+    }
+    return supported;
+}
+
+// Widest kernel set the running CPU supports, detected once
+static const SimdKernels& simd() {
+    static const SimdKernels* best = supportedSimdKernels().back();
+    return *best;
+}
+
+class vect;
+class matr;
+
+// Lazy element-wise arithmetic: operators on vect/matr build expression objects, and
+// the whole chain is evaluated in one loop into the destination when it is assigned
+// or used to construct a vect/matr. Expressions keep references to their vect/matr
+// operands, so they must be evaluated within the statement that builds them.
+
+// Kinds keep vector and matrix expressions from being mixed
+struct VectorKind {
+    static const char* mismatch() { return "Error: different dimensions!"; }
+};
+struct MatrixKind {
+    static const char* mismatch() { return "Error: different matrix dimensions!"; }
+};
+
+// Shape of an expression result; negative rows mark operands of different shapes
+struct ExprShape {
+    int rows, cols;
+    bool valid() const { return rows >= 0; }
+};
+
+// Common shape of two operands, reporting a mismatch once where it happens
+template <typename Kind>
+ExprShape combineShapes(ExprShape left, ExprShape right) {
+    if (!left.valid() || !right.valid()) return {-1, -1};
+    if (left.rows != right.rows || left.cols != right.cols) {
+        cerr << Kind::mismatch() << endl;
+        return {-1, -1};
+    }
+    return left;
+}
+
+// Base of every expression; Derived provides shape(), operator[] and describe()
+template <typename Kind, typename Derived>
+struct Expr {
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+// vect and matr are held by reference, intermediate expressions by value
+template <typename T> struct ExprLeaf : false_type {};
+template <> struct ExprLeaf<vect> : true_type {};
+template <> struct ExprLeaf<matr> : true_type {};
+template <typename T>
+using ExprOperand = typename conditional<ExprLeaf<T>::value, const T&, const T>::type;
+
+// Element-wise binary operations
+struct AddOp {
+    static double apply(double x, double y) { return x + y; }
+    static const char* symbol() { return " + "; }
+};
+struct SubOp {
+    static double apply(double x, double y) { return x - y; }
+    static const char* symbol() { return " - "; }
+};
+
+template <typename Kind, typename Op, typename L, typename R>
+struct BinaryExpr : Expr<Kind, BinaryExpr<Kind, Op, L, R>> {
+    ExprOperand<L> left;
+    ExprOperand<R> right;
+    ExprShape resultShape;
+
+    BinaryExpr(const L& l, const R& r) : left(l), right(r), resultShape(combineShapes<Kind>(l.shape(), r.shape())) {}
+    ExprShape shape() const { return resultShape; }
+    double operator[](int i) const { return Op::apply(left[i], right[i]); }
+    void describe(ostream& os) const {
+        os << "(";
+        left.describe(os);
+        os << Op::symbol();
+        right.describe(os);
+        os << ")";
+    }
+};
+
+template <typename Kind, typename E>
+struct NegExpr : Expr<Kind, NegExpr<Kind, E>> {
+    ExprOperand<E> operand;
+
+    explicit NegExpr(const E& e) : operand(e) {}
+    ExprShape shape() const { return operand.shape(); }
+    double operator[](int i) const { return -operand[i]; }
+    void describe(ostream& os) const { os << "-"; operand.describe(os); }
+};
+
+template <typename Kind, typename E>
+struct ScaledExpr : Expr<Kind, ScaledExpr<Kind, E>> {
+    double k;
+    ExprOperand<E> operand;
+
+    ScaledExpr(double factor, const E& e) : k(factor), operand(e) {}
+    ExprShape shape() const { return operand.shape(); }
+    double operator[](int i) const { return k * operand[i]; }
+    void describe(ostream& os) const { os << k << " * "; operand.describe(os); }
+};
+
+// Streams the description of an expression: cout << described(e)
+template <typename E>
+struct ExprDescription {
+    const E& e;
+};
+template <typename E>
+ostream& operator<<(ostream& os, ExprDescription<E> d) {
+    d.e.describe(os);
+    return os;
+}
+template <typename E>
+ExprDescription<E> described(const E& e) { return {e}; }
+
+template <typename Kind, typename L, typename R>
+BinaryExpr<Kind, AddOp, L, R> operator+(const Expr<Kind, L>& l, const Expr<Kind, R>& r) {
+    return BinaryExpr<Kind, AddOp, L, R>(l.self(), r.self());
+}
+
+template <typename Kind, typename L, typename R>
+BinaryExpr<Kind, SubOp, L, R> operator-(const Expr<Kind, L>& l, const Expr<Kind, R>& r) {
+    return BinaryExpr<Kind, SubOp, L, R>(l.self(), r.self());
+}
+
+template <typename Kind, typename E>
+NegExpr<Kind, E> operator-(const Expr<Kind, E>& e) {
+    return NegExpr<Kind, E>(e.self());
+}
+
+template <typename Kind, typename E>
+ScaledExpr<Kind, E> operator*(double k, const Expr<Kind, E>& e) {
+    return ScaledExpr<Kind, E>(k, e.self());
+}
+
+// Write count elements of an expression to out in one fused loop
+template <typename E>
+void evaluateExpr(double* out, const E& e, int count) {
+    for (int i = 0; i < count; i++) out[i] = e[i];
+}
+
+// A single operation on vect/matr operands goes straight to the SIMD kernels
+template <typename Kind, typename T>
+typename enable_if<ExprLeaf<T>::value>::type
+evaluateExpr(double* out, const BinaryExpr<Kind, AddOp, T, T>& e, int count) {
+    simd().add(e.left.data(), e.right.data(), out, count);
+}
+
+template <typename Kind, typename T>
+typename enable_if<ExprLeaf<T>::value>::type
+evaluateExpr(double* out, const BinaryExpr<Kind, SubOp, T, T>& e, int count) {
+    simd().sub(e.left.data(), e.right.data(), out, count);
+}
+
+template <typename Kind, typename T>
+typename enable_if<ExprLeaf<T>::value>::type
+evaluateExpr(double* out, const NegExpr<Kind, T>& e, int count) {
+    simd().neg(e.operand.data(), out, count);
+}
+
+template <typename Kind, typename T>
+typename enable_if<ExprLeaf<T>::value>::type
+evaluateExpr(double* out, const ScaledExpr<Kind, T>& e, int count) {
+    simd().scale(e.k, e.operand.data(), out, count);
+}
+
+// Lifecycle tracing of vect and matr, chosen at compile time with -DLAB2_LIFECYCLE=<level>:
+// 0 (default) does nothing, 1 keeps atomic counters that can be queried at run time,
+// 2 also logs every creation, copy, move, assignment, destruction and operation.
+#ifndef LAB2_LIFECYCLE
+#define LAB2_LIFECYCLE 0
+#endif
+
+template <int Level>
+struct LifecyclePolicy {
+    static constexpr bool COUNT = Level >= 1;  // Keep the counters
+    static constexpr bool LOG = Level >= 2;    // Write a line to cout for every event
+};
+using Lifecycle = LifecyclePolicy<LAB2_LIFECYCLE>;
+
+// Writes one log line; the stream expression is compiled out below level 2
+#define LIFECYCLE_LOG(message) do { if (Lifecycle::LOG) cout << message << endl; } while (0)
+
+// Counter values at one point in time
+struct LifecycleStats {
+    long long creations;  // Objects constructed, copies and moves included
+    long long copies;     // Copy constructions and copy assignments
+    long long moves;      // Move constructions and move assignments
+    long long bytes;      // Element bytes allocated
+};
+
+// Counters shared by all objects of one class
+class LifecycleCounters {
+private:
+    atomic<long long> creations{0}, copies{0}, moves{0}, bytes{0};
+
+public:
+    void created() { if (Lifecycle::COUNT) creations.fetch_add(1, memory_order_relaxed); }
+    void copied() { if (Lifecycle::COUNT) copies.fetch_add(1, memory_order_relaxed); }
+    void moved() { if (Lifecycle::COUNT) moves.fetch_add(1, memory_order_relaxed); }
+    void allocated(long long elements) {
+        if (Lifecycle::COUNT) bytes.fetch_add(elements * (long long)sizeof(double), memory_order_relaxed);
+    }
+
+    LifecycleStats snapshot() const {
+        return {creations.load(memory_order_relaxed), copies.load(memory_order_relaxed),
+                moves.load(memory_order_relaxed), bytes.load(memory_order_relaxed)};
+    }
+};
+
 // Vector class for mathematical vector operations
-class vect {
+class vect : public Expr<VectorKind, vect> {
 private:
     int dim;        // Stores the dimension (size) of the vector
     double* b;      // Pointer to dynamically allocated array storing vector elements
     int num;        // Unique identifier for each vector instance
-    static int count; // Static counter to track total number of vector objects created
+    static atomic<int> count; // Static counter to track total number of vector objects created
+    static LifecycleCounters stats; // Lifecycle counters of all vectors
 
 public:
     // Default constructor - creates empty vector
     vect() : dim(0), b(nullptr) {
         num = ++count;  // Assigns unique ID by incrementing static counter
-        cout << "Created vector #" << num << " (default)" << endl; // Creation message
+        stats.created();
+        LIFECYCLE_LOG("Created vector #" << num << " (default)"); // Creation message
     }
 
     // Parameterized constructor - creates vector of given dimension
@@ -21,7 +626,9 @@ public:
         b = new double[dim];  // Allocates memory for vector elements
         for (int i = 0; i < dim; i++) b[i] = 0; // Initializes all elements to zero
         num = ++count;  // Assigns unique ID
-        cout << "Created vector #" << num << " (dimension " << dim << ")" << endl;
+        stats.created();
+        stats.allocated(dim);
+        LIFECYCLE_LOG("Created vector #" << num << " (dimension " << dim << ")");
     }
 
     // Copy constructor - creates copy of existing vector
@@ -29,73 +636,100 @@ public:
         b = new double[dim];  // Allocates new memory
         for (int i = 0; i < dim; i++) b[i] = v.b[i]; // Copies all elements
         num = ++count;  // New unique ID for the copy
-        cout << "Created vector #" << num << " (copy of vector #" << v.num << ")" << endl;
+        stats.created();
+        stats.copied();
+        stats.allocated(dim);
+        LIFECYCLE_LOG("Created vector #" << num << " (copy of vector #" << v.num << ")");
+    }
+
+    // Move constructor - takes over the elements of a vector that is about to go away
+    vect(vect&& v) noexcept : dim(v.dim), b(v.b) {
+        v.dim = 0;
+        v.b = nullptr;
+        num = ++count;
+        stats.created();
+        stats.moved();
+        LIFECYCLE_LOG("Created vector #" << num << " (moved from vector #" << v.num << ")");
     }
 
     // Destructor - cleans up dynamically allocated memory
     ~vect() {
         delete[] b;  // Frees the allocated array
-        cout << "Destroyed vector #" << num << endl; // Destruction message
+        LIFECYCLE_LOG("Destroyed vector #" << num); // Destruction message
+    }
+
+    // Expression constructor - evaluates a chain of element-wise operations in one pass
+    template <typename E>
+    vect(const Expr<VectorKind, E>& expr) : dim(0), b(nullptr) {
+        const E& e = expr.self();
+        num = ++count;
+        stats.created();
+        if (!e.shape().valid()) {  // Mismatched operands give an empty vector
+            LIFECYCLE_LOG("Created vector #" << num << " (default)");
+            return;
+        }
+        dim = e.shape().rows;
+        b = new double[dim];
+        stats.allocated(dim);
+        evaluateExpr(b, e, dim);
+        LIFECYCLE_LOG("Created vector #" << num << " = " << described(e));
     }
 
     // Assignment operator - copies contents from one vector to another
     vect& operator=(const vect& v) {
-        cout << "Assignment: vector #" << num << " = vector #" << v.num << endl;
+        LIFECYCLE_LOG("Assignment: vector #" << num << " = vector #" << v.num);
         if (this != &v) {  // Check for self-assignment
             delete[] b;  // Free existing memory
             dim = v.dim;  // Copy dimension
             b = new double[dim];  // Allocate new memory
             for (int i = 0; i < dim; i++) b[i] = v.b[i]; // Copy elements
+            stats.copied();
+            stats.allocated(dim);
         }
         return *this;  // Return reference to current object
     }
 
-    // Vector addition operator
-    vect operator+(const vect& v) {
-        cout << "Addition: vector #" << num << " + vector #" << v.num << endl;
-        if (dim != v.dim) {  // Check for compatible dimensions
-            cerr << "Error: different dimensions!" << endl;
-            return vect();  // Return empty vector if incompatible
-        }
-        vect res(dim);  // Create result vector
-        for (int i = 0; i < dim; i++) res.b[i] = b[i] + v.b[i]; // Element-wise addition
-        return res;  // Return result
+    // Move assignment - swaps buffers, the old one is freed with the source
+    vect& operator=(vect&& v) noexcept {
+        LIFECYCLE_LOG("Assignment: vector #" << num << " = moved vector #" << v.num);
+        swap(dim, v.dim);
+        swap(b, v.b);
+        stats.moved();
+        return *this;
     }
 
-    // Vector subtraction operator
-    vect operator-(const vect& v) {
-        cout << "Subtraction: vector #" << num << " - vector #" << v.num << endl;
-        if (dim != v.dim) {  // Dimension check
-            cerr << "Error: different dimensions!" << endl;
-            return vect();
+    // Expression assignment - evaluates in place, reallocating only when the size changes
+    template <typename E>
+    vect& operator=(const Expr<VectorKind, E>& expr) {
+        const E& e = expr.self();
+        LIFECYCLE_LOG("Assignment: vector #" << num << " = " << described(e));
+        int newDim = e.shape().valid() ? e.shape().rows : 0;
+        if (newDim != dim) {
+            delete[] b;
+            dim = newDim;
+            b = dim > 0 ? new double[dim] : nullptr;
+            stats.allocated(dim);
         }
-        vect res(dim);
-        for (int i = 0; i < dim; i++) res.b[i] = b[i] - v.b[i]; // Element-wise subtraction
-        return res;
+        evaluateExpr(b, e, dim);  // Element i only reads operand elements i, so aliasing is safe
+        return *this;
     }
 
-    // Unary minus operator (negation)
-    vect operator-() {
-        cout << "Unary minus: -vector #" << num << endl;
-        vect res(dim);  // Create result vector
-        for (int i = 0; i < dim; i++) res.b[i] = -b[i]; // Negate each element
-        return res;
-    }
+    // Lifecycle counters of all vectors (zero unless LAB2_LIFECYCLE >= 1)
+    static LifecycleStats lifecycleStats() { return stats.snapshot(); }
 
     // Dot product operator
     double operator*(const vect& v) {
-        cout << "Dot product: vector #" << num << " * vector #" << v.num << endl;
+        LIFECYCLE_LOG("Dot product: vector #" << num << " * vector #" << v.num);
         if (dim != v.dim) {  // Dimension check
             cerr << "Error: different dimensions!" << endl;
             return 0.0;  // Return zero if incompatible
         }
-        double res = 0;  // Initialize result
-        for (int i = 0; i < dim; i++) res += b[i] * v.b[i]; // Sum of products
-        return res;
+        return simd().dot(b, v.b, dim); // Sum of products
     }
 
-    // Friend function for scalar multiplication (allows commutative operation)
-    friend vect operator*(double k, const vect& v);
+    // Matrices read and write vector elements directly
+    friend class matr;
+    friend class spmatr;
 
     // Print vector contents
     void print() {
@@ -109,160 +743,417 @@ public:
     int get_num() const { return num; }  // Returns vector ID
     double get(int i) const { return (i >= 0 && i < dim) ? b[i] : 0.0; } // Safe element access
     void set(int i, double val) { if (i >= 0 && i < dim) b[i] = val; } // Safe element modification
+    const double* data() const { return b; }  // Element buffer
+    double* data() { return b; }
+
+    // Expression leaf interface
+    ExprShape shape() const { return {dim, 1}; }
+    double operator[](int i) const { return b[i]; }
+    void describe(ostream& os) const { os << "vector #" << num; }
 };
 
-// Initialize static counter
-int vect::count = 0;
+// Initialize static counters
+atomic<int> vect::count(0);
+LifecycleCounters vect::stats;
 
-// Scalar multiplication (friend function implementation)
-vect operator*(double k, const vect& v) {
-    cout << "Multiplication: " << k << " * vector #" << v.num << endl;
-    vect res(v.dim);  // Create result vector
-    for (int i = 0; i < v.dim; i++) res.set(i, k * v.get(i)); // Multiply each element
-    return res;
+// Copy an mc x kc block of A into GEMM_MR-row slivers, zero-padding the last one
+static void packA(int mc, int kc, const double* A, int lda, double* packed) {
+    for (int i0 = 0; i0 < mc; i0 += GEMM_MR) {
+        int rows = min(GEMM_MR, mc - i0);
+        for (int p = 0; p < kc; p++) {
+            for (int i = 0; i < GEMM_MR; i++) {
+                *packed++ = i < rows ? A[(i0 + i) * lda + p] : 0.0;
+            }
+        }
+    }
+}
+
+// Copy a kc x nc block of B into GEMM_NR-column slivers, zero-padding the last one
+static void packB(int kc, int nc, const double* B, int ldb, double* packed) {
+    for (int j0 = 0; j0 < nc; j0 += GEMM_NR) {
+        int cols = min(GEMM_NR, nc - j0);
+        for (int p = 0; p < kc; p++) {
+            const double* row = B + p * ldb + j0;
+            for (int j = 0; j < GEMM_NR; j++) {
+                *packed++ = j < cols ? row[j] : 0.0;
+            }
+        }
+    }
+}
+
+// Doubles gemmBlocked packs at once from A (rows x depth) and from B (depth x cols)
+static size_t gemmPackSizeA(int rows, int depth) {
+    return (size_t)(min(GEMM_MC, rows) + GEMM_MR - 1) / GEMM_MR * GEMM_MR * min(GEMM_KC, depth);
+}
+static size_t gemmPackSizeB(int cols, int depth) {
+    return (size_t)(min(GEMM_NC, cols) + GEMM_NR - 1) / GEMM_NR * GEMM_NR * min(GEMM_KC, depth);
+}
+
+// Start of at least size doubles in buffer, aligned to a cache line. The buffer only
+// grows, so a thread reuses it for every later product of the same or smaller size.
+static double* gemmPackBuffer(vector<double>& buffer, size_t size) {
+    const size_t LINE = 64 / sizeof(double);
+    if (buffer.size() < size + LINE) buffer.resize(size + LINE);
+    size_t offset = reinterpret_cast<uintptr_t>(buffer.data()) / sizeof(double) % LINE;
+    return buffer.data() + (LINE - offset) % LINE;
+}
+
+// Packed, cache-blocked C += alpha * A * B. Every element of C is accumulated in the
+// same order however the rows are split between calls. The packed blocks live in
+// buffers of the calling thread, so repeated products do not allocate.
+static void gemmBlocked(int rows, int cols, int depth, double alpha,
+                        const double* A, int lda, const double* B, int ldb, double* C, int ldc) {
+    static thread_local vector<double> bufferA, bufferB;
+    double* packedA = gemmPackBuffer(bufferA, gemmPackSizeA(rows, depth));
+    double* packedB = gemmPackBuffer(bufferB, gemmPackSizeB(cols, depth));
+    const SimdKernels& kernels = simd();
+
+    for (int jc = 0; jc < cols; jc += GEMM_NC) {
+        int nc = min(GEMM_NC, cols - jc);
+        for (int pc = 0; pc < depth; pc += GEMM_KC) {
+            int kc = min(GEMM_KC, depth - pc);
+            packB(kc, nc, B + pc * ldb + jc, ldb, packedB);
+
+            for (int ic = 0; ic < rows; ic += GEMM_MC) {
+                int mc = min(GEMM_MC, rows - ic);
+                packA(mc, kc, A + ic * lda + pc, lda, packedA);
+
+                for (int jr = 0; jr < nc; jr += GEMM_NR) {
+                    for (int ir = 0; ir < mc; ir += GEMM_MR) {
+                        kernels.gemmKernel(kc, alpha, packedA + ir * kc, packedB + jr * kc,
+                                           C + (ic + ir) * ldc + jc + jr, ldc,
+                                           min(GEMM_MR, mc - ir), min(GEMM_NR, nc - jr));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Products up to this many multiply-adds skip packing
+const long long GEMM_SMALL = 32 * 32 * 32;
+
+// C += alpha * A * B for row-major A (rows x depth), B (depth x cols), C (rows x cols).
+// ld* are the distances between consecutive rows of each matrix.
+static void gemm(int rows, int cols, int depth, double alpha,
+                 const double* A, int lda, const double* B, int ldb, double* C, int ldc) {
+    if ((long long)rows * cols * depth <= GEMM_SMALL) {
+        // Small product: packing would cost more than it saves
+        for (int i = 0; i < rows; i++)
+            for (int k = 0; k < depth; k++) {
+                double aik = alpha * A[i * lda + k];
+                for (int j = 0; j < cols; j++) C[i * ldc + j] += aik * B[k * ldb + j];
+            }
+        return;
+    }
+    gemmBlocked(rows, cols, depth, alpha, A, lda, B, ldb, C, ldc);
+}
+
+// Fixed set of worker threads that run the tasks of one job at a time. The calling
+// thread works on the job too, so a pool of size 1 has no workers at all.
+class ThreadPool {
+private:
+    vector<thread> workers;
+    mutex jobLock;                  // Serializes callers of run()
+    mutex stateLock;                // Guards the fields below
+    condition_variable jobReady;    // Signals workers that a new job started
+    condition_variable jobDone;     // Signals the caller that all workers finished
+    const function<void(int)>* job = nullptr;  // Task body of the current job
+    int jobTasks = 0;               // Number of tasks in the current job
+    atomic<int> nextTask{0};        // Next task index to hand out
+    int busyWorkers = 0;            // Workers still inside the current job
+    long long generation = 0;       // Incremented for every job
+    bool stopping = false;
+
+    // Jobs the current thread is running tasks of, across all pools
+    static inline thread_local int jobDepth = 0;
+
+    // Run tasks of the current job until none are left
+    void drain() {
+        jobDepth++;
+        for (int t = nextTask.fetch_add(1); t < jobTasks; t = nextTask.fetch_add(1)) (*job)(t);
+        jobDepth--;
+    }
+
+    void workerLoop() {
+        long long seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> guard(stateLock);
+                jobReady.wait(guard, [&]() { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            drain();
+            lock_guard<mutex> guard(stateLock);
+            if (--busyWorkers == 0) jobDone.notify_one();
+        }
+    }
+
+public:
+    explicit ThreadPool(int threads) {
+        for (int i = 1; i < threads; i++) workers.emplace_back([this]() { workerLoop(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(stateLock);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (thread& worker : workers) worker.join();
+    }
+
+    // Threads working on a job, the caller included
+    int size() const { return (int)workers.size() + 1; }
+
+    // Call task(0) ... task(tasks - 1), spread over the pool, and wait for all of them.
+    // Callers on different threads take turns. A task that calls run() again (on any
+    // pool) gets its nested job run serially on its own thread, since waiting for the
+    // pool it is part of would deadlock.
+    void run(int tasks, const function<void(int)>& task) {
+        if (jobDepth > 0) {
+            for (int t = 0; t < tasks; t++) task(t);
+            return;
+        }
+        lock_guard<mutex> callGuard(jobLock);
+        {
+            lock_guard<mutex> guard(stateLock);
+            job = &task;
+            jobTasks = tasks;
+            nextTask = 0;
+            busyWorkers = (int)workers.size();
+            generation++;
+        }
+        jobReady.notify_all();
+        drain();
+        unique_lock<mutex> guard(stateLock);
+        jobDone.wait(guard, [&]() { return busyWorkers == 0; });
+        job = nullptr;
+    }
+};
+
+// Threads used by matrix products; 1 runs everything on the calling thread
+static atomic<int> matrixThreadCount(max(1, (int)thread::hardware_concurrency()));
+
+void setMatrixThreads(int threads) { matrixThreadCount = max(1, threads); }
+int matrixThreads() { return matrixThreadCount; }
+
+// Pool shared by matrix products, rebuilt when the thread count changes. Callers keep
+// the returned pointer for the whole job, so a rebuild requested meanwhile by another
+// thread replaces the shared pool without destroying the one still in use.
+static shared_ptr<ThreadPool> matrixPool() {
+    static mutex poolLock;
+    static shared_ptr<ThreadPool> pool;
+    lock_guard<mutex> guard(poolLock);
+    int threads = matrixThreadCount;
+    if (!pool || pool->size() != threads) pool = make_shared<ThreadPool>(threads);
+    return pool;
+}
+
+// Products with fewer multiply-adds than this stay on one thread
+const long long PARALLEL_MIN_WORK = 128LL * 128 * 128;   // Matrix by matrix
+const long long PARALLEL_MIN_ROWS_WORK = 256LL * 256;    // Row-by-row products
+
+// gemm with the rows of C split into blocks that the matrix pool computes in parallel.
+// Each block runs the same blocked kernel over the full depth, so the result does not
+// depend on the number of threads.
+static void parallelGemm(int rows, int cols, int depth, double alpha,
+                         const double* A, int lda, const double* B, int ldb, double* C, int ldc) {
+    long long work = (long long)rows * cols * depth;
+    if (matrixThreadCount == 1 || work <= GEMM_SMALL || work < PARALLEL_MIN_WORK || rows < 2 * GEMM_MR) {
+        gemm(rows, cols, depth, alpha, A, lda, B, ldb, C, ldc);
+        return;
+    }
+    shared_ptr<ThreadPool> pool = matrixPool();
+    // About four blocks per thread for balance, each a whole number of micro-kernel rows
+    int blockRows = (rows + 4 * pool->size() - 1) / (4 * pool->size());
+    blockRows = max(GEMM_MR, (blockRows + GEMM_MR - 1) / GEMM_MR * GEMM_MR);
+    int blocks = (rows + blockRows - 1) / blockRows;
+    pool->run(blocks, [&](int block) {
+        int first = block * blockRows;
+        gemmBlocked(min(blockRows, rows - first), cols, depth, alpha,
+                    A + (long long)first * lda, lda, B, ldb, C + (long long)first * ldc, ldc);
+    });
+}
+
+// Call body(first, last) on row ranges that cover [0, rows). Small work (multiply-adds)
+// runs as one range on the calling thread, larger work as about four ranges per pool
+// thread. Rows must be independent of each other.
+static void forEachRowBlock(int rows, long long work, const function<void(int, int)>& body) {
+    if (matrixThreadCount == 1 || work < PARALLEL_MIN_ROWS_WORK || rows < 2) {
+        body(0, rows);
+        return;
+    }
+    shared_ptr<ThreadPool> pool = matrixPool();
+    int blockRows = max(1, (rows + 4 * pool->size() - 1) / (4 * pool->size()));
+    pool->run((rows + blockRows - 1) / blockRows, [&](int block) {
+        body(block * blockRows, min(rows, (block + 1) * blockRows));
+    });
 }
 
 // Matrix class for mathematical matrix operations
-class matr {
+class matr : public Expr<MatrixKind, matr> {
 private:
     int n, m;       // Dimensions (rows, columns)
-    double** a;     // 2D array for matrix elements
+    double* a;      // Elements in one row-major buffer: element (i, j) is a[i * m + j]
     int num;        // Unique identifier
-    static int count; // Static counter for matrix instances
+    static atomic<int> count; // Static counter for matrix instances (atomic: products may run on several threads)
+    static LifecycleCounters stats; // Lifecycle counters of all matrices
+
+    size_t elements() const { return (size_t)n * m; }  // Buffer size, computed without int overflow
 
 public:
     // Default constructor - creates empty matrix
     matr() : n(0), m(0), a(nullptr) {
         num = ++count;
-        cout << "Created matrix #" << num << " (default)" << endl;
+        stats.created();
+        LIFECYCLE_LOG("Created matrix #" << num << " (default)");
     }
 
     // Parameterized constructor - creates matrix of given dimensions
     matr(int rows, int cols) : n(rows), m(cols) {
-        a = new double*[n];  // Allocate row pointers
-        for (int i = 0; i < n; i++) {
-            a[i] = new double[m];  // Allocate each row
-            for (int j = 0; j < m; j++) a[i][j] = 0; // Initialize to zero
-        }
+        a = new double[elements()]();  // Allocate all elements at once, initialized to zero
         num = ++count;
-        cout << "Created matrix #" << num << " (" << n << "x" << m << ")" << endl;
+        stats.created();
+        stats.allocated(elements());
+        LIFECYCLE_LOG("Created matrix #" << num << " (" << n << "x" << m << ")");
     }
 
     // Copy constructor - creates copy of existing matrix
     matr(const matr& mat) : n(mat.n), m(mat.m) {
-        a = new double*[n];  // Allocate row pointers
-        for (int i = 0; i < n; i++) {
-            a[i] = new double[m];  // Allocate each row
-            for (int j = 0; j < m; j++) a[i][j] = mat.a[i][j]; // Copy elements
-        }
+        a = new double[elements()];  // Allocate all elements
+        copy(mat.a, mat.a + elements(), a); // Copy elements
+        num = ++count;
+        stats.created();
+        stats.copied();
+        stats.allocated(elements());
+        LIFECYCLE_LOG("Created matrix #" << num << " (copy of matrix #" << mat.num << ")");
+    }
+
+    // Move constructor - takes over the element buffer of a matrix that is about to go away
+    matr(matr&& mat) noexcept : n(mat.n), m(mat.m), a(mat.a) {
+        mat.n = mat.m = 0;
+        mat.a = nullptr;
         num = ++count;
-        cout << "Created matrix #" << num << " (copy of matrix #" << mat.num << ")" << endl;
+        stats.created();
+        stats.moved();
+        LIFECYCLE_LOG("Created matrix #" << num << " (moved from matrix #" << mat.num << ")");
     }
 
     // Destructor - cleans up dynamically allocated memory
     ~matr() {
-        if (a != nullptr) {  // Check if memory was allocated
-            for (int i = 0; i < n; i++) delete[] a[i]; // Free each row
-            delete[] a;  // Free row pointers
+        delete[] a;  // Free the element buffer
+        LIFECYCLE_LOG("Destroyed matrix #" << num);
+    }
+
+    // Expression constructor - evaluates a chain of element-wise operations in one pass
+    template <typename E>
+    matr(const Expr<MatrixKind, E>& expr) : n(0), m(0), a(nullptr) {
+        const E& e = expr.self();
+        num = ++count;
+        stats.created();
+        if (!e.shape().valid()) {  // Mismatched operands give an empty matrix
+            LIFECYCLE_LOG("Created matrix #" << num << " (default)");
+            return;
         }
-        cout << "Destroyed matrix #" << num << endl;
+        n = e.shape().rows;
+        m = e.shape().cols;
+        a = new double[elements()];
+        stats.allocated(elements());
+        evaluateExpr(a, e, n * m);
+        LIFECYCLE_LOG("Created matrix #" << num << " = " << described(e));
     }
 
     // Assignment operator - copies matrix contents
     matr& operator=(const matr& mat) {
-        cout << "Assignment: matrix #" << num << " = matrix #" << mat.num << endl;
+        LIFECYCLE_LOG("Assignment: matrix #" << num << " = matrix #" << mat.num);
         if (this != &mat) {  // Check for self-assignment
-            // Free existing memory
-            for (int i = 0; i < n; i++) delete[] a[i];
-            delete[] a;
-
-            // Copy dimensions and allocate new memory
+            // Reallocate only when the size changes
+            if (elements() != mat.elements()) {
+                delete[] a;
+                a = new double[mat.elements()];
+                stats.allocated(mat.elements());
+            }
             n = mat.n;
             m = mat.m;
-            a = new double*[n];
-            for (int i = 0; i < n; i++) {
-                a[i] = new double[m];
-                for (int j = 0; j < m; j++) a[i][j] = mat.a[i][j]; // Copy elements
-            }
+            copy(mat.a, mat.a + elements(), a); // Copy elements
+            stats.copied();
         }
         return *this;
     }
 
-    // Matrix addition operator
-    matr operator+(const matr& mat) {
-        cout << "Addition: matrix #" << num << " + matrix #" << mat.num << endl;
-        if (n != mat.n || m != mat.m) {  // Dimension check
-            cerr << "Error: different matrix dimensions!" << endl;
-            return matr();  // Return empty matrix if incompatible
-        }
-        matr res(n, m);  // Create result matrix
-        for (int i = 0; i < n; i++)
-            for (int j = 0; j < m; j++)
-                res.a[i][j] = a[i][j] + mat.a[i][j]; // Element-wise addition
-        return res;
+    // Move assignment - swaps buffers, the old one is freed with the source
+    matr& operator=(matr&& mat) noexcept {
+        LIFECYCLE_LOG("Assignment: matrix #" << num << " = moved matrix #" << mat.num);
+        swap(n, mat.n);
+        swap(m, mat.m);
+        swap(a, mat.a);
+        stats.moved();
+        return *this;
     }
 
-    // Matrix subtraction operator
-    matr operator-(const matr& mat) {
-        cout << "Subtraction: matrix #" << num << " - matrix #" << mat.num << endl;
-        if (n != mat.n || m != mat.m) {  // Dimension check
-            cerr << "Error: different matrix dimensions!" << endl;
-            return matr();
+    // Expression assignment - evaluates in place, reallocating only when the size changes
+    template <typename E>
+    matr& operator=(const Expr<MatrixKind, E>& expr) {
+        const E& e = expr.self();
+        LIFECYCLE_LOG("Assignment: matrix #" << num << " = " << described(e));
+        ExprShape shape = e.shape().valid() ? e.shape() : ExprShape{0, 0};
+        size_t size = (size_t)shape.rows * shape.cols;
+        if (size != elements()) {
+            delete[] a;
+            a = size > 0 ? new double[size] : nullptr;
+            stats.allocated(size);
         }
-        matr res(n, m);
-        for (int i = 0; i < n; i++)
-            for (int j = 0; j < m; j++)
-                res.a[i][j] = a[i][j] - mat.a[i][j]; // Element-wise subtraction
-        return res;
+        n = shape.rows;
+        m = shape.cols;
+        evaluateExpr(a, e, n * m);  // Element i only reads operand elements i, so aliasing is safe
+        return *this;
     }
 
-    // Unary minus operator (matrix negation)
-    matr operator-() {
-        cout << "Unary minus: -matrix #" << num << endl;
-        matr res(n, m);  // Create result matrix
-        for (int i = 0; i < n; i++)
-            for (int j = 0; j < m; j++)
-                res.a[i][j] = -a[i][j]; // Negate each element
-        return res;
-    }
+    // Lifecycle counters of all matrices (zero unless LAB2_LIFECYCLE >= 1)
+    static LifecycleStats lifecycleStats() { return stats.snapshot(); }
 
-    // Matrix multiplication operator
+    // Matrix multiplication operator (cache-blocked and multi-threaded, see parallelGemm)
     matr operator*(const matr& mat) {
-        cout << "Multiplication: matrix #" << num << " * matrix #" << mat.num << endl;
+        LIFECYCLE_LOG("Multiplication: matrix #" << num << " * matrix #" << mat.num);
         if (m != mat.n) {  // Check for compatible dimensions
             cerr << "Error: incompatible matrix dimensions!" << endl;
             return matr();
         }
         matr res(n, mat.m);  // Result has rows of first, columns of second
-        for (int i = 0; i < n; i++)
-            for (int j = 0; j < mat.m; j++)
-                for (int k = 0; k < m; k++)
-                    res.a[i][j] += a[i][k] * mat.a[k][j]; // Dot product of row and column
+        parallelGemm(n, mat.m, m, 1.0, a, m, mat.a, mat.m, res.a, res.m);
         return res;
     }
 
-    // Matrix-vector multiplication operator
+    // Matrix-vector multiplication operator (row blocks run on the matrix pool)
     vect operator*(const vect& v) {
-        cout << "Multiplication: matrix #" << num << " * vector #" << v.get_num() << endl;
+        LIFECYCLE_LOG("Multiplication: matrix #" << num << " * vector #" << v.get_num());
         if (m != v.get_dim()) {  // Check for compatible dimensions
             cerr << "Error: incompatible dimensions!" << endl;
             return vect();
         }
         vect res(n);  // Result vector has size equal to matrix rows
-        for (int i = 0; i < n; i++)
-            for (int j = 0; j < m; j++)
-                res.set(i, res.get(i) + a[i][j] * v.get(j)); // Matrix-vector product
+        const SimdKernels& kernels = simd();
+        forEachRowBlock(n, (long long)n * m, [&](int first, int last) {
+            for (int i = first; i < last; i++) res.b[i] = kernels.dot(a + (long long)i * m, v.b, m); // Row times vector
+        });
         return res;
     }
 
-    // Friend function for scalar multiplication
-    friend matr operator*(double k, const matr& mat);
+    // Solve A x = b, determinant and inverse via LU decomposition (see ludecomp)
+    vect solve(const vect& b) const;
+    double determinant() const;
+    matr inverse() const;
 
     // Print matrix contents
     void print() {
         cout << "Matrix #" << num << " (" << n << "x" << m << "):" << endl;
         for (int i = 0; i < n; i++) {
-            for (int j = 0; j < m; j++) cout << a[i][j] << " "; // Print each element
+            for (int j = 0; j < m; j++) cout << a[i * m + j] << " "; // Print each element
             cout << endl;
         }
     }
@@ -271,31 +1162,1521 @@ public:
     int get_n() const { return n; }  // Returns number of rows
     int get_m() const { return m; }  // Returns number of columns
     int get_num() const { return num; }  // Returns matrix ID
-    double get(int i, int j) const { return (i >= 0 && i < n && j >= 0 && j < m) ? a[i][j] : 0.0; } // Safe element access
-    void set(int i, int j, double val) { if (i >= 0 && i < n && j >= 0 && j < m) a[i][j] = val; } // Safe element modification
+    double get(int i, int j) const { return (i >= 0 && i < n && j >= 0 && j < m) ? a[i * m + j] : 0.0; } // Safe element access
+    void set(int i, int j, double val) { if (i >= 0 && i < n && j >= 0 && j < m) a[i * m + j] = val; } // Safe element modification
+    const double* data() const { return a; }  // Row-major element buffer
+    double* data() { return a; }
+
+    // Expression leaf interface
+    ExprShape shape() const { return {n, m}; }
+    double operator[](int i) const { return a[i]; }
+    void describe(ostream& os) const { os << "matrix #" << num; }
 };
 
-// Initialize static counter
-int matr::count = 0;
+// Initialize static counters
+atomic<int> matr::count(0);
+LifecycleCounters matr::stats;
 
-// Scalar multiplication for matrices (friend function implementation)
-matr operator*(double k, const matr& mat) {
-    cout << "Multiplication: " << k << " * matrix #" << mat.num << endl;
-    matr res(mat.n, mat.m);  // Create result matrix
-    for (int i = 0; i < mat.n; i++)
-        for (int j = 0; j < mat.m; j++)
-            res.set(i, j, k * mat.get(i, j)); // Multiply each element by scalar
-    return res;
-}
+// Columns factorized per panel of the blocked LU decomposition
+const int LU_BLOCK = 64;
 
-// Main function demonstrating vector and matrix operations
-int main() {
-    cout << "=== Vector demonstration ===" << endl;
-    // Create two 3D vectors
-    vect v1(3), v2(3);
-    // Set vector elements
-    v1.set(0, 1); v1.set(1, 2); v1.set(2, 3);
-    v2.set(0, 4); v2.set(1, 5); v2.set(2, 6);
+// LU decomposition with partial pivoting, P * A = L * U. L (unit diagonal, not stored)
+// and U share one matrix. The factorization is right-looking and blocked: a panel of
+// LU_BLOCK columns is factorized, the block row of U is solved for, and the trailing
+// matrix gets a rank-LU_BLOCK update through the packed, multi-threaded gemm, which does
+// almost all of the work.
+class ludecomp {
+private:
+    int n;                // Order of the matrix
+    matr factors;         // L below the diagonal, U on and above it
+    vector<int> pivots;   // Row k was swapped with row pivots[k] at step k
+    int swaps = 0;        // Number of actual row exchanges (sign of the determinant)
+    bool isSingular = false;
+    bool isValid = true;  // False when the input could not be factorized (not square)
+
+    double* row(int i) { return factors.data() + (long long)i * n; }
+    const double* row(int i) const { return factors.data() + (long long)i * n; }
+
+    // Unblocked factorization of columns [k0, k0 + kb) for rows k0..n-1. Whole rows are
+    // exchanged, so the L columns to the left and the U rows to the right follow the pivots.
+    void factorPanel(int k0, int kb) {
+        for (int j = k0; j < k0 + kb; j++) {
+            int pivot = j;
+            for (int i = j + 1; i < n; i++)
+                if (fabs(row(i)[j]) > fabs(row(pivot)[j])) pivot = i;
+            pivots[j] = pivot;
+            if (pivot != j) {
+                swap_ranges(row(j), row(j) + n, row(pivot));
+                swaps++;
+            }
+            double diagonal = row(j)[j];
+            if (diagonal == 0.0) {  // Nothing to eliminate with; U stays singular
+                isSingular = true;
+                continue;
+            }
+            for (int i = j + 1; i < n; i++) {
+                double* r = row(i);
+                double l = r[j] /= diagonal;
+                for (int c = j + 1; c < k0 + kb; c++) r[c] -= l * row(j)[c];
+            }
+        }
+    }
+
+    // U12 = inverse(L11) * A12 for the block row right of the panel
+    void solveBlockRow(int k0, int kb) {
+        for (int i = k0 + 1; i < k0 + kb; i++) {
+            double* r = row(i);
+            for (int p = k0; p < i; p++) {
+                double l = r[p];
+                const double* source = row(p);
+                for (int c = k0 + kb; c < n; c++) r[c] -= l * source[c];
+            }
+        }
+    }
+
+public:
+    // Factorize a square matrix; other shapes are reported and give an empty decomposition
+    explicit ludecomp(const matr& A) : n(A.get_n()), factors(A), pivots(A.get_n()) {
+        if (A.get_n() != A.get_m()) {
+            cerr << "Error: matrix is not square!" << endl;
+            n = 0;
+            isSingular = true;
+            isValid = false;
+            return;
+        }
+        for (int k0 = 0; k0 < n; k0 += LU_BLOCK) {
+            int kb = min(LU_BLOCK, n - k0);
+            factorPanel(k0, kb);
+            int rest = n - k0 - kb;
+            if (rest == 0) continue;
+            solveBlockRow(k0, kb);
+            // A22 -= L21 * U12
+            parallelGemm(rest, rest, kb, -1.0, row(k0 + kb) + k0, n, row(k0) + k0 + kb, n,
+                         row(k0 + kb) + k0 + kb, n);
+        }
+    }
+
+    bool singular() const { return isSingular; }
+    bool valid() const { return isValid; }
+    int order() const { return n; }
+    const matr& get_factors() const { return factors; }
+
+    // Product of the pivots, negated for an odd number of row exchanges; 1 for a 0x0
+    // matrix and NaN when there is no valid decomposition
+    double determinant() const {
+        if (!isValid) return NAN;  // Already reported by the constructor
+        double res = swaps % 2 == 0 ? 1.0 : -1.0;
+        for (int i = 0; i < n; i++) res *= row(i)[i];
+        return res;
+    }
+
+    // Solve A x = b by permuting b, then forward substitution with L and back substitution with U
+    vect solve(const vect& b) const {
+        if (b.get_dim() != n) {
+            cerr << "Error: incompatible dimensions!" << endl;
+            return vect();
+        }
+        if (isSingular) {
+            cerr << "Error: matrix is singular!" << endl;
+            return vect();
+        }
+        vect x(b);
+        double* y = x.data();
+        for (int k = 0; k < n; k++) swap(y[k], y[pivots[k]]);
+        for (int i = 0; i < n; i++) y[i] -= simd().dot(row(i), y, i);
+        for (int i = n - 1; i >= 0; i--) y[i] = (y[i] - simd().dot(row(i) + i + 1, y + i + 1, n - i - 1)) / row(i)[i];
+        return x;
+    }
+
+    // Solve A X = B for all columns of B at once, working on whole rows of X
+    matr solve(const matr& B) const {
+        if (B.get_n() != n) {
+            cerr << "Error: incompatible matrix dimensions!" << endl;
+            return matr();
+        }
+        if (isSingular) {
+            cerr << "Error: matrix is singular!" << endl;
+            return matr();
+        }
+        int cols = B.get_m();
+        matr X(B);
+        double* x = X.data();
+        auto xrow = [&](int i) { return x + (long long)i * cols; };
+        for (int k = 0; k < n; k++)
+            if (pivots[k] != k) swap_ranges(xrow(k), xrow(k) + cols, xrow(pivots[k]));
+        for (int i = 0; i < n; i++)
+            for (int p = 0; p < i; p++) {
+                double l = row(i)[p];
+                if (l != 0.0) for (int c = 0; c < cols; c++) xrow(i)[c] -= l * xrow(p)[c];
+            }
+        for (int i = n - 1; i >= 0; i--) {
+            for (int p = i + 1; p < n; p++) {
+                double u = row(i)[p];
+                if (u != 0.0) for (int c = 0; c < cols; c++) xrow(i)[c] -= u * xrow(p)[c];
+            }
+            double diagonal = row(i)[i];
+            for (int c = 0; c < cols; c++) xrow(i)[c] /= diagonal;
+        }
+        return X;
+    }
+
+    // Inverse: the solution of A X = I
+    matr inverse() const {
+        matr identity(n, n);
+        for (int i = 0; i < n; i++) identity.set(i, i, 1.0);
+        return solve(identity);
+    }
+};
+
+// Linear algebra on matr through a fresh LU decomposition; factorize once with
+// ludecomp to solve many systems with the same matrix
+vect matr::solve(const vect& b) const { return ludecomp(*this).solve(b); }
+double matr::determinant() const { return ludecomp(*this).determinant(); }
+matr matr::inverse() const { return ludecomp(*this).inverse(); }
+
+// Nonzero element of a sparse matrix under construction
+struct Triplet {
+    int row, col;
+    double value;
+};
+
+// Sparse matrix in coordinate form: an unordered list of (row, column, value) entries,
+// cheap to build in any order. Duplicate entries are summed when converted to spmatr.
+class coo {
+private:
+    int n, m;                 // Dimensions (rows, columns)
+    vector<Triplet> entries;  // Entries in insertion order
+
+public:
+    coo(int rows, int cols) : n(rows), m(cols) {}
+
+    // Add value at (i, j); out-of-range positions are ignored like matr::set
+    void add(int i, int j, double value) {
+        if (i >= 0 && i < n && j >= 0 && j < m) entries.push_back({i, j, value});
+    }
+
+    void reserve(size_t count) { entries.reserve(count); }
+
+    int get_n() const { return n; }
+    int get_m() const { return m; }
+    const vector<Triplet>& get_entries() const { return entries; }
+};
+
+// Sparse matrix in compressed sparse row (CSR) form: the nonzeros of row i are
+// values[rowStart[i] .. rowStart[i + 1]), sorted by column. Memory and the cost of
+// every operation grow with the number of nonzeros, not with n * m.
+class spmatr {
+private:
+    int n, m;                 // Dimensions (rows, columns)
+    vector<int> rowStart;     // n + 1 offsets into colIndex/values
+    vector<int> colIndex;     // Column of every nonzero
+    vector<double> values;    // Value of every nonzero
+
+    // Append a nonzero to the row being built; exact zeros are not stored
+    void push(int col, double value) {
+        if (value == 0.0) return;
+        colIndex.push_back(col);
+        values.push_back(value);
+    }
+
+public:
+    // Empty matrix with no nonzeros
+    spmatr(int rows = 0, int cols = 0) : n(rows), m(cols), rowStart(rows + 1, 0) {}
+
+    // Build from coordinate form: bucket the entries by row, sort each row by column and
+    // sum duplicates
+    explicit spmatr(const coo& builder) : n(builder.get_n()), m(builder.get_m()), rowStart(n + 1, 0) {
+        const vector<Triplet>& entries = builder.get_entries();
+        vector<int> next(n + 1, 0);
+        for (const Triplet& t : entries) next[t.row + 1]++;
+        for (int i = 0; i < n; i++) next[i + 1] += next[i];
+        vector<pair<int, double>> byRow(entries.size());  // (column, value), grouped by row
+        for (const Triplet& t : entries) byRow[next[t.row]++] = {t.col, t.value};
+
+        colIndex.reserve(entries.size());
+        values.reserve(entries.size());
+        size_t first = 0;
+        for (int i = 0; i < n; i++) {
+            size_t last = next[i];  // After the scatter, next[i] is the end of row i
+            sort(byRow.begin() + first, byRow.begin() + last,
+                 [](const pair<int, double>& x, const pair<int, double>& y) { return x.first < y.first; });
+            for (size_t k = first; k < last;) {
+                int col = byRow[k].first;
+                double sum = 0;
+                for (; k < last && byRow[k].first == col; k++) sum += byRow[k].second;
+                push(col, sum);
+            }
+            rowStart[i + 1] = (int)values.size();
+            first = last;
+        }
+    }
+
+    // Keep the nonzeros of a dense matrix
+    explicit spmatr(const matr& dense) : n(dense.get_n()), m(dense.get_m()), rowStart(n + 1, 0) {
+        const double* a = dense.data();
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < m; j++) push(j, a[(long long)i * m + j]);
+            rowStart[i + 1] = (int)values.size();
+        }
+    }
+
+    // Expand to a dense matrix
+    matr toDense() const {
+        matr res(n, m);
+        double* a = res.data();
+        for (int i = 0; i < n; i++)
+            for (int k = rowStart[i]; k < rowStart[i + 1]; k++) a[(long long)i * m + colIndex[k]] = values[k];
+        return res;
+    }
+
+    // Sparse matrix-vector product (SpMV); row blocks run on the matrix pool
+    vect operator*(const vect& v) const {
+        if (m != v.get_dim()) {
+            cerr << "Error: incompatible dimensions!" << endl;
+            return vect();
+        }
+        vect res(n);
+        const double* x = v.data();
+        double* y = res.b;
+        forEachRowBlock(n, nnz(), [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                double sum = 0;
+                for (int k = rowStart[i]; k < rowStart[i + 1]; k++) sum += values[k] * x[colIndex[k]];
+                y[i] = sum;
+            }
+        });
+        return res;
+    }
+
+    // Sparse times dense: every nonzero (i, k) adds a scaled row k of the dense matrix to row i
+    matr operator*(const matr& dense) const {
+        if (m != dense.get_n()) {
+            cerr << "Error: incompatible matrix dimensions!" << endl;
+            return matr();
+        }
+        int cols = dense.get_m();
+        matr res(n, cols);
+        const double* b = dense.data();
+        double* c = res.data();
+        forEachRowBlock(n, (long long)nnz() * cols, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                double* row = c + (long long)i * cols;
+                for (int k = rowStart[i]; k < rowStart[i + 1]; k++) {
+                    const double* source = b + (long long)colIndex[k] * cols;
+                    double scale = values[k];
+                    for (int j = 0; j < cols; j++) row[j] += scale * source[j];
+                }
+            }
+        });
+        return res;
+    }
+
+    // Sparse sum: merge the sorted rows of both matrices, dropping cancelled entries
+    spmatr operator+(const spmatr& other) const {
+        if (n != other.n || m != other.m) {
+            cerr << "Error: different matrix dimensions!" << endl;
+            return spmatr();
+        }
+        spmatr res(n, m);
+        res.colIndex.reserve(nnz() + other.nnz());
+        res.values.reserve(nnz() + other.nnz());
+        for (int i = 0; i < n; i++) {
+            int p = rowStart[i], q = other.rowStart[i];
+            int pEnd = rowStart[i + 1], qEnd = other.rowStart[i + 1];
+            while (p < pEnd || q < qEnd) {
+                if (q == qEnd || (p < pEnd && colIndex[p] < other.colIndex[q])) {
+                    res.push(colIndex[p], values[p]);
+                    p++;
+                } else if (p == pEnd || other.colIndex[q] < colIndex[p]) {
+                    res.push(other.colIndex[q], other.values[q]);
+                    q++;
+                } else {
+                    res.push(colIndex[p], values[p] + other.values[q]);
+                    p++;
+                    q++;
+                }
+            }
+            res.rowStart[i + 1] = (int)res.values.size();
+        }
+        return res;
+    }
+
+    // Element (i, j), zero when not stored or out of range
+    double get(int i, int j) const {
+        if (i < 0 || i >= n || j < 0 || j >= m) return 0.0;
+        auto first = colIndex.begin() + rowStart[i], last = colIndex.begin() + rowStart[i + 1];
+        auto found = lower_bound(first, last, j);
+        return found != last && *found == j ? values[found - colIndex.begin()] : 0.0;
+    }
+
+    // Print the nonzeros row by row
+    void print() const {
+        cout << "Sparse matrix (" << n << "x" << m << ", " << nnz() << " nonzeros):" << endl;
+        for (int i = 0; i < n; i++) {
+            if (rowStart[i] == rowStart[i + 1]) continue;
+            cout << "row " << i << ":";
+            for (int k = rowStart[i]; k < rowStart[i + 1]; k++) cout << " (" << colIndex[k] << ", " << values[k] << ")";
+            cout << endl;
+        }
+    }
+
+    int get_n() const { return n; }
+    int get_m() const { return m; }
+    int nnz() const { return (int)values.size(); }  // Number of stored nonzeros
+    size_t bytes() const {  // Memory used by the CSR arrays
+        return rowStart.size() * sizeof(int) + colIndex.size() * sizeof(int) + values.size() * sizeof(double);
+    }
+};
+
+// Fixed-size vector: the dimension is a template argument and the elements live inline,
+// so there is no allocation, no runtime dimension check, and a dimension mismatch is a
+// compile error. Every operation is constexpr and expands to one statement per element.
+template <int N>
+class fvect {
+    static_assert(N > 0, "fvect needs at least one element");
+
+private:
+    double b[N] = {};  // Elements, zero-initialized
+
+    template <int> friend class fvect;
+    template <int, int> friend class fmatr;
+
+    // Element i is f(i), written out for every index
+    template <typename F, size_t... I>
+    constexpr fvect(F f, index_sequence<I...>) : b{f((int)I)...} {}
+
+    template <typename F>
+    static constexpr fvect generate(F f) { return fvect(f, make_index_sequence<N>()); }
+
+    template <size_t... I>
+    constexpr double dot(const fvect& v, index_sequence<I...>) const { return ((b[I] * v.b[I]) + ...); }
+
+public:
+    constexpr fvect() = default;
+
+    // fvect<3> v(1, 2, 3); exactly N numbers are required
+    template <typename... T, typename = typename enable_if<sizeof...(T) == N && conjunction<is_arithmetic<T>...>::value>::type>
+    constexpr fvect(T... values) : b{(double)values...} {}
+
+    // Copy of a dynamic vector; a different dimension is reported and gives zeros
+    static fvect fromDynamic(const vect& v) {
+        fvect res;
+        if (v.get_dim() != N) {
+            cerr << "Error: different dimensions!" << endl;
+            return res;
+        }
+        for (int i = 0; i < N; i++) res.b[i] = v.data()[i];
+        return res;
+    }
+
+    // Dynamic copy, so a fixed vector can be passed wherever a vect is expected
+    operator vect() const {
+        vect res(N);
+        for (int i = 0; i < N; i++) res.set(i, b[i]);
+        return res;
+    }
+
+    constexpr fvect operator+(const fvect& v) const { return generate([&](int i) { return b[i] + v.b[i]; }); }
+    constexpr fvect operator-(const fvect& v) const { return generate([&](int i) { return b[i] - v.b[i]; }); }
+    constexpr fvect operator-() const { return generate([&](int i) { return -b[i]; }); }
+    constexpr double operator*(const fvect& v) const { return dot(v, make_index_sequence<N>()); } // Dot product
+    friend constexpr fvect operator*(double k, const fvect& v) { return generate([&](int i) { return k * v.b[i]; }); }
+
+    constexpr double operator[](int i) const { return b[i]; }
+    constexpr double& operator[](int i) { return b[i]; }
+    static constexpr int get_dim() { return N; }
+
+    // Print vector contents
+    void print() const {
+        cout << "Vector<" << N << "> [";
+        for (int i = 0; i < N; i++) cout << b[i] << (i < N - 1 ? ", " : "");
+        cout << "]" << endl;
+    }
+};
+
+// Fixed-size R x C matrix stored inline in one row-major array, with the same
+// compile-time guarantees as fvect
+template <int R, int C>
+class fmatr {
+    static_assert(R > 0 && C > 0, "fmatr needs at least one element");
+
+private:
+    double a[R * C] = {};  // Element (i, j) is a[i * C + j]
+
+    template <int, int> friend class fmatr;
+
+    template <typename F, size_t... I>
+    constexpr fmatr(F f, index_sequence<I...>) : a{f((int)I)...} {}
+
+    // Element with flat index k is f(k)
+    template <typename F>
+    static constexpr fmatr generate(F f) { return fmatr(f, make_index_sequence<R * C>()); }
+
+    // Row i of this matrix times column j of other
+    template <int K, size_t... I>
+    constexpr double rowTimesColumn(int i, const fmatr<C, K>& other, int j, index_sequence<I...>) const {
+        return ((a[i * C + I] * other.a[I * K + j]) + ...);
+    }
+
+    template <size_t... I>
+    constexpr double rowTimesVector(int i, const fvect<C>& v, index_sequence<I...>) const {
+        return ((a[i * C + I] * v.b[I]) + ...);
+    }
+
+public:
+    constexpr fmatr() = default;
+
+    // Row-major list of exactly R * C numbers
+    template <typename... T, typename = typename enable_if<sizeof...(T) == R * C && conjunction<is_arithmetic<T>...>::value>::type>
+    constexpr fmatr(T... values) : a{(double)values...} {}
+
+    static constexpr fmatr identity() { return generate([](int k) { return k / C == k % C ? 1.0 : 0.0; }); }
+
+    // Copy of a dynamic matrix; different dimensions are reported and give zeros
+    static fmatr fromDynamic(const matr& mat) {
+        fmatr res;
+        if (mat.get_n() != R || mat.get_m() != C) {
+            cerr << "Error: different matrix dimensions!" << endl;
+            return res;
+        }
+        for (int k = 0; k < R * C; k++) res.a[k] = mat.data()[k];
+        return res;
+    }
+
+    // Dynamic copy, so a fixed matrix can be passed wherever a matr is expected
+    operator matr() const {
+        matr res(R, C);
+        for (int k = 0; k < R * C; k++) res.data()[k] = a[k];
+        return res;
+    }
+
+    constexpr fmatr operator+(const fmatr& mat) const { return generate([&](int k) { return a[k] + mat.a[k]; }); }
+    constexpr fmatr operator-(const fmatr& mat) const { return generate([&](int k) { return a[k] - mat.a[k]; }); }
+    constexpr fmatr operator-() const { return generate([&](int k) { return -a[k]; }); }
+    friend constexpr fmatr operator*(double k, const fmatr& mat) { return generate([&](int i) { return k * mat.a[i]; }); }
+
+    // Product with a C x K matrix; the inner dimensions must agree at compile time
+    template <int K>
+    constexpr fmatr<R, K> operator*(const fmatr<C, K>& other) const {
+        return fmatr<R, K>::generate([&](int k) { return rowTimesColumn(k / K, other, k % K, make_index_sequence<C>()); });
+    }
+
+    constexpr fvect<R> operator*(const fvect<C>& v) const {
+        return fvect<R>::generate([&](int i) { return rowTimesVector(i, v, make_index_sequence<C>()); });
+    }
+
+    constexpr double operator()(int i, int j) const { return a[i * C + j]; }
+    constexpr double& operator()(int i, int j) { return a[i * C + j]; }
+    static constexpr int get_n() { return R; }
+    static constexpr int get_m() { return C; }
+
+    // Print matrix contents
+    void print() const {
+        cout << "Matrix<" << R << "x" << C << ">:" << endl;
+        for (int i = 0; i < R; i++) {
+            for (int j = 0; j < C; j++) cout << a[i * C + j] << " ";
+            cout << endl;
+        }
+    }
+};
+
+// The fixed-size operations are usable in constant expressions
+static_assert(fvect<3>(1, 2, 3) * fvect<3>(4, 5, 6) == 32, "constexpr dot product");
+static_assert((fmatr<2, 2>(1, 2, 3, 4) * fmatr<2, 2>::identity())(1, 0) == 3, "constexpr matrix product");
+
+// On-disk matrix file: this 64-byte header followed by the rows * cols elements in
+// row-major order, so the elements of a mapped file are 64-byte aligned
+struct MatrixFileHeader {
+    char magic[8];      // "LAB2MAT1"
+    uint64_t rows;
+    uint64_t cols;
+    char reserved[40];  // Zero
+};
+
+static const char MATRIX_FILE_MAGIC[8] = {'L', 'A', 'B', '2', 'M', 'A', 'T', '1'};
+
+// Aligned window of a file mapping that a read fault maps at once (Linux fault-around)
+const size_t FAULT_AROUND_BYTES = 64 * 1024;
+
+// Matrix stored in a file and accessed through a memory mapping, so it can be larger
+// than RAM: only the pages in use are resident and the rest stay on disk. Where mmap
+// is not available the whole file is read into memory and written back on close.
+class mappedmatr {
+private:
+    char* base;          // Start of the mapped file
+    size_t bytes;        // Size of the mapped file
+    double* a;           // Elements inside the mapping
+    int n, m;            // Dimensions (rows, columns)
+    bool writable;       // Mapped for writing
+#ifdef _WIN32
+    vector<char> buffer; // Whole file, where mmap is not available
+    string path;         // File to write the buffer back to
+#endif
+
+    // Map (or read) a file of the given size; the caller checks or writes the header
+    bool map(const string& filename, bool forWriting, size_t fileBytes, bool create) {
+#ifdef _WIN32
+        if (create) {
+            buffer.assign(fileBytes, 0);
+        } else {
+            ifstream inFile(filename, ios::binary);
+            if (!inFile.is_open()) return false;
+            buffer.assign(istreambuf_iterator<char>(inFile), istreambuf_iterator<char>());
+        }
+        path = filename;
+        base = buffer.data();
+        bytes = buffer.size();
+#else
+        int flags = forWriting ? O_RDWR : O_RDONLY;
+        if (create) flags |= O_CREAT | O_TRUNC;
+        int descriptor = ::open(filename.c_str(), flags, 0644);
+        if (descriptor < 0) return false;
+        struct stat status;
+        if (create && ftruncate(descriptor, fileBytes) != 0) {
+            ::close(descriptor);
+            return false;
+        }
+        if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+            void* mapping = mmap(nullptr, status.st_size, forWriting ? PROT_READ | PROT_WRITE : PROT_READ,
+                                 MAP_SHARED, descriptor, 0);
+            if (mapping != MAP_FAILED) {
+                // Tiles touch a few rows at a time and release them; readahead would
+                // map large folios far past those rows into the resident set
+                madvise(mapping, status.st_size, MADV_RANDOM);
+                base = static_cast<char*>(mapping);
+                bytes = status.st_size;
+            }
+        }
+        ::close(descriptor);
+#endif
+        writable = forWriting;
+        return base != nullptr;
+    }
+
+public:
+    mappedmatr() : base(nullptr), bytes(0), a(nullptr), n(0), m(0), writable(false) {}
+
+    mappedmatr(const mappedmatr&) = delete;
+    mappedmatr& operator=(const mappedmatr&) = delete;
+
+    ~mappedmatr() { close(); }
+
+    // Create (or overwrite) a zero-filled rows x cols matrix file and map it for writing
+    bool create(const string& filename, int rows, int cols) {
+        close();
+        size_t fileBytes = sizeof(MatrixFileHeader) + (size_t)rows * cols * sizeof(double);
+        if (rows < 0 || cols < 0 || !map(filename, true, fileBytes, true)) {
+            cerr << "Error: Could not create matrix file: " << filename << endl;
+            close();
+            return false;
+        }
+        MatrixFileHeader header = {};
+        memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+        header.rows = rows;
+        header.cols = cols;
+        memcpy(base, &header, sizeof(header));
+        n = rows;
+        m = cols;
+        a = reinterpret_cast<double*>(base + sizeof(header));
+        return true;
+    }
+
+    // Map an existing matrix file and check that it is well formed
+    bool open(const string& filename, bool forWriting = false) {
+        close();
+        if (!map(filename, forWriting, 0, false)) {
+            cerr << "Error: Could not open matrix file: " << filename << endl;
+            close();
+            return false;
+        }
+        MatrixFileHeader header;
+        if (bytes < sizeof(header)) {
+            cerr << "Error: Matrix file is truncated: " << filename << endl;
+            close();
+            return false;
+        }
+        memcpy(&header, base, sizeof(header));
+        if (memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) != 0 || header.rows > INT32_MAX ||
+            header.cols > INT32_MAX || header.rows * header.cols != (bytes - sizeof(header)) / sizeof(double)) {
+            cerr << "Error: Not a valid matrix file: " << filename << endl;
+            close();
+            return false;
+        }
+        n = (int)header.rows;
+        m = (int)header.cols;
+        a = reinterpret_cast<double*>(base + sizeof(header));
+        return true;
+    }
+
+    // Unmap the file; written elements are in the file afterwards
+    void close() {
+#ifdef _WIN32
+        if (base != nullptr && writable) {
+            ofstream outFile(path, ios::binary);
+            outFile.write(base, bytes);
+        }
+        buffer.clear();
+#else
+        if (base != nullptr) munmap(base, bytes);
+#endif
+        base = nullptr;
+        a = nullptr;
+        bytes = 0;
+        n = m = 0;
+        writable = false;
+    }
+
+    // Write a dense matrix to a matrix file
+    static bool save(const matr& mat, const string& filename) {
+        ofstream outFile(filename, ios::binary);
+        if (!outFile.is_open()) {
+            cerr << "Error: Could not open file for saving: " << filename << endl;
+            return false;
+        }
+        MatrixFileHeader header = {};
+        memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+        header.rows = mat.get_n();
+        header.cols = mat.get_m();
+        outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        outFile.write(reinterpret_cast<const char*>(mat.data()), (streamsize)mat.get_n() * mat.get_m() * sizeof(double));
+        return (bool)outFile;
+    }
+
+    // Copy into a dense in-memory matrix
+    matr load() const {
+        matr res(n, m);
+        copy(a, a + (size_t)n * m, res.data());
+        return res;
+    }
+
+    // Drop the resident pages of elements [first, first + count) from this process;
+    // they are read back from the page cache or the file on the next access. A fault
+    // maps the cached pages of its whole fault-around window, so the range is widened
+    // to the windows around it; otherwise touching the next rows would map the released
+    // ends of this range again and leave them resident.
+    void release(size_t first, size_t count) const {
+#ifndef _WIN32
+        if (count == 0) return;
+        uintptr_t start = reinterpret_cast<uintptr_t>(a + first) / FAULT_AROUND_BYTES * FAULT_AROUND_BYTES;
+        uintptr_t end = (reinterpret_cast<uintptr_t>(a + first + count) + FAULT_AROUND_BYTES - 1) / FAULT_AROUND_BYTES * FAULT_AROUND_BYTES;
+        start = max(start, reinterpret_cast<uintptr_t>(base));
+        end = min(end, reinterpret_cast<uintptr_t>(base) + bytes);
+        madvise(reinterpret_cast<void*>(start), end - start, MADV_DONTNEED);
+#else
+        (void)first;
+        (void)count;
+#endif
+    }
+
+    bool is_open() const { return base != nullptr; }
+    int get_n() const { return n; }
+    int get_m() const { return m; }
+    size_t elementBytes() const { return (size_t)n * m * sizeof(double); }
+    double get(int i, int j) const { return (i >= 0 && i < n && j >= 0 && j < m) ? a[(size_t)i * m + j] : 0.0; }
+    void set(int i, int j, double val) { if (writable && i >= 0 && i < n && j >= 0 && j < m) a[(size_t)i * m + j] = val; }
+    const double* data() const { return a; }
+    double* data() { return a; }  // Writable only after create() or open(filename, true)
+};
+
+// Element-wise sum of two matrix files into a new one, a band of rows at a time; the
+// bands of the three matrices and the fault-around windows next to them together take
+// about memoryBudget bytes
+bool tiledAdd(const mappedmatr& A, const mappedmatr& B, const string& resultFile, size_t memoryBudget) {
+    if (A.get_n() != B.get_n() || A.get_m() != B.get_m()) {
+        cerr << "Error: different matrix dimensions!" << endl;
+        return false;
+    }
+    int n = A.get_n(), m = A.get_m();
+    mappedmatr C;
+    if (!C.create(resultFile, n, m)) return false;
+    size_t rowBytes = max<size_t>(1, (size_t)m * sizeof(double));
+    size_t bandBudget = memoryBudget - min(memoryBudget, 3 * 2 * FAULT_AROUND_BYTES);
+    int band = (int)max<size_t>(1, bandBudget / (3 * rowBytes));
+    for (int i0 = 0; i0 < n; i0 += band) {
+        int rows = min(band, n - i0);
+        size_t first = (size_t)i0 * m, count = (size_t)rows * m;
+        for (int i = 0; i < rows; i++)
+            simd().add(A.data() + first + (size_t)i * m, B.data() + first + (size_t)i * m, C.data() + first + (size_t)i * m, m);
+        A.release(first, count);
+        B.release(first, count);
+        C.release(first, count);
+    }
+    return true;
+}
+
+// Bytes tiledMultiply keeps resident for tile x tile tiles: the three tile buffers and
+// the packing buffers of every thread that multiplies them
+static size_t tiledMultiplyBytes(int tile, int threads) {
+    size_t packing = gemmPackSizeA(tile, tile) + gemmPackSizeB(tile, tile) + 2 * 64 / sizeof(double);
+    return (3 * (size_t)tile * tile + (size_t)threads * packing) * sizeof(double);
+}
+
+// Product of two matrix files into a new one. C is computed one T x T tile at a time:
+// the matching T x T tiles of A and B are copied into buffers, multiplied with the
+// packed gemm and accumulated, then the finished tile is written out. The tile buffers,
+// the gemm packing buffers of the matrix threads and the mapped rows in use take at
+// most memoryBudget bytes.
+// Each row segment of the mapped files is released as soon as it has been read or
+// written, so only the segments in use and their fault-around windows are mapped.
+bool tiledMultiply(const mappedmatr& A, const mappedmatr& B, const string& resultFile, size_t memoryBudget) {
+    if (A.get_m() != B.get_n()) {
+        cerr << "Error: incompatible matrix dimensions!" << endl;
+        return false;
+    }
+    int n = A.get_n(), depth = A.get_m(), m = B.get_m();
+    mappedmatr C;
+    if (!C.create(resultFile, n, m)) return false;
+    // The row segment in use of each file and its fault-around windows are resident too
+    size_t segmentBytes = (size_t)min(max(n, max(depth, m)), (int)sqrt((double)memoryBudget / sizeof(double))) * sizeof(double);
+    size_t tileBudget = memoryBudget - min(memoryBudget, 3 * (2 * FAULT_AROUND_BYTES + segmentBytes));
+    int threads = matrixThreads();
+    int tile = (int)sqrt((double)tileBudget / (3 * sizeof(double)));
+    while (tile > GEMM_MR && tiledMultiplyBytes(tile, threads) > tileBudget) tile--;
+    tile = max(GEMM_MR, min(tile, max(n, max(depth, m))));
+    vector<double> tileA((size_t)tile * tile), tileB((size_t)tile * tile), tileC((size_t)tile * tile);
+
+    for (int i0 = 0; i0 < n; i0 += tile) {
+        int rows = min(tile, n - i0);
+        for (int j0 = 0; j0 < m; j0 += tile) {
+            int cols = min(tile, m - j0);
+            fill(tileC.begin(), tileC.end(), 0.0);
+            for (int k0 = 0; k0 < depth; k0 += tile) {
+                int inner = min(tile, depth - k0);
+                for (int i = 0; i < rows; i++) {
+                    const double* source = A.data() + (size_t)(i0 + i) * depth + k0;
+                    copy(source, source + inner, tileA.data() + (size_t)i * inner);
+                    A.release((size_t)(i0 + i) * depth + k0, inner);
+                }
+                for (int k = 0; k < inner; k++) {
+                    const double* source = B.data() + (size_t)(k0 + k) * m + j0;
+                    copy(source, source + cols, tileB.data() + (size_t)k * cols);
+                    B.release((size_t)(k0 + k) * m + j0, cols);
+                }
+                parallelGemm(rows, cols, inner, 1.0, tileA.data(), inner, tileB.data(), cols, tileC.data(), cols);
+            }
+            for (int i = 0; i < rows; i++) {
+                copy(tileC.data() + (size_t)i * cols, tileC.data() + (size_t)(i + 1) * cols, C.data() + (size_t)(i0 + i) * m + j0);
+                C.release((size_t)(i0 + i) * m + j0, cols);
+            }
+        }
+    }
+    return true;
+}
+
+// Batch of same-shape small matrices, interleaved in groups of BATCH_LANES: element
+// (i, j) of the matrices of one group is stored in BATCH_LANES consecutive doubles, so
+// one SIMD register holds the same element of several matrices and a whole batch is
+// multiplied with plain vector loads and fused multiply-adds. Vectors are batches with
+// one column. The last group is padded with zero matrices.
+class matrbatch {
+private:
+    int count;              // Number of matrices
+    int n, m;               // Dimensions of every matrix (rows, columns)
+    vector<double> storage; // groups() * n * m * BATCH_LANES elements
+
+    size_t index(int b, int i, int j) const {
+        return ((size_t)(b / BATCH_LANES) * n * m + (size_t)i * m + j) * BATCH_LANES + b % BATCH_LANES;
+    }
+
+public:
+    matrbatch(int matrices = 0, int rows = 0, int cols = 0)
+        : count(matrices), n(rows), m(cols),
+          storage((size_t)(matrices + BATCH_LANES - 1) / BATCH_LANES * rows * cols * BATCH_LANES, 0.0) {}
+
+    // Batch of matrices stored back to back, each one row-major
+    static matrbatch fromArray(const double* matrices, int count, int rows, int cols) {
+        matrbatch res(count, rows, cols);
+        for (int b = 0; b < count; b++)
+            for (int i = 0; i < rows; i++)
+                for (int j = 0; j < cols; j++) res.storage[res.index(b, i, j)] = *matrices++;
+        return res;
+    }
+
+    // Write the matrices back to back, each one row-major
+    void toArray(double* out) const {
+        for (int b = 0; b < count; b++)
+            for (int i = 0; i < n; i++)
+                for (int j = 0; j < m; j++) *out++ = storage[index(b, i, j)];
+    }
+
+    int size() const { return count; }
+    int groups() const { return (count + BATCH_LANES - 1) / BATCH_LANES; }
+    int get_n() const { return n; }
+    int get_m() const { return m; }
+    double get(int b, int i, int j) const {
+        return (b >= 0 && b < count && i >= 0 && i < n && j >= 0 && j < m) ? storage[index(b, i, j)] : 0.0;
+    }
+    void set(int b, int i, int j, double val) {
+        if (b >= 0 && b < count && i >= 0 && i < n && j >= 0 && j < m) storage[index(b, i, j)] = val;
+    }
+    const double* group(int g) const { return storage.data() + (size_t)g * n * m * BATCH_LANES; }
+    double* group(int g) { return storage.data() + (size_t)g * n * m * BATCH_LANES; }
+};
+
+// C[b] = A[b] * B[b] for every matrix of the batches. C is resized when needed. Groups
+// run on the matrix pool when the batch is large enough.
+bool batchMultiply(const matrbatch& A, const matrbatch& B, matrbatch& C) {
+    if (A.size() != B.size() || A.get_m() != B.get_n()) {
+        cerr << "Error: incompatible batch dimensions!" << endl;
+        return false;
+    }
+    int rows = A.get_n(), depth = A.get_m(), cols = B.get_m();
+    if (C.size() != A.size() || C.get_n() != rows || C.get_m() != cols) C = matrbatch(A.size(), rows, cols);
+    const SimdKernels& kernels = simd();
+    forEachRowBlock(A.groups(), (long long)A.size() * rows * depth * cols, [&](int first, int last) {
+        for (int g = first; g < last; g++) kernels.batchGemm(rows, depth, cols, A.group(g), B.group(g), C.group(g));
+    });
+    return true;
+}
+
+// C[b] = A[b] * B[b] for count matrices stored back to back in plain row-major arrays
+// (A: rows x depth, B: depth x cols, C: rows x cols). Every group of BATCH_LANES is
+// interleaved into a small buffer, multiplied and copied back, so the caller keeps its
+// usual layout. Matrix-vector products are the case cols = 1.
+void batchMultiply(const double* A, const double* B, double* C, int count, int rows, int depth, int cols) {
+    const SimdKernels& kernels = simd();
+    int groups = (count + BATCH_LANES - 1) / BATCH_LANES;
+    forEachRowBlock(groups, (long long)count * rows * depth * cols, [&](int first, int last) {
+        vector<double> a((size_t)rows * depth * BATCH_LANES), b((size_t)depth * cols * BATCH_LANES);
+        vector<double> c((size_t)rows * cols * BATCH_LANES);
+        for (int g = first; g < last; g++) {
+            int lanes = min(BATCH_LANES, count - g * BATCH_LANES);
+            if (lanes < BATCH_LANES) {  // Padding lanes of the last group
+                fill(a.begin(), a.end(), 0.0);
+                fill(b.begin(), b.end(), 0.0);
+            }
+            for (int l = 0; l < lanes; l++) {
+                const double* sourceA = A + (size_t)(g * BATCH_LANES + l) * rows * depth;
+                const double* sourceB = B + (size_t)(g * BATCH_LANES + l) * depth * cols;
+                for (int e = 0; e < rows * depth; e++) a[(size_t)e * BATCH_LANES + l] = sourceA[e];
+                for (int e = 0; e < depth * cols; e++) b[(size_t)e * BATCH_LANES + l] = sourceB[e];
+            }
+            kernels.batchGemm(rows, depth, cols, a.data(), b.data(), c.data());
+            for (int l = 0; l < lanes; l++) {
+                double* target = C + (size_t)(g * BATCH_LANES + l) * rows * cols;
+                for (int e = 0; e < rows * cols; e++) target[e] = c[(size_t)e * BATCH_LANES + l];
+            }
+        }
+    });
+}
+
+// Time a piece of work in seconds
+template <typename Work>
+double timeSeconds(Work work) {
+    auto start = chrono::steady_clock::now();
+    work();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Compare every supported kernel set with the scalar kernels on lengths that
+// exercise both the vector body and the remainder loop. Element-wise results must
+// match exactly; dot products may differ by rounding from the reordered sum.
+int runSimdTest() {
+    mt19937 random(12345);
+    uniform_real_distribution<double> values(-100.0, 100.0);
+    const SimdKernels& reference = SIMD_KERNELS[0];
+    int failures = 0;
+    for (const SimdKernels* kernels : supportedSimdKernels()) {
+        for (int count = 0; count <= 1000; count += (count < 70 ? 1 : 131)) {
+            vector<double> x(count), y(count), expected(count), actual(count);
+            for (int i = 0; i < count; i++) {
+                x[i] = values(random);
+                y[i] = values(random);
+            }
+            if (count > 0) x[0] = 0.0;  // Negating +0.0 must give -0.0
+
+            auto check = [&](const char* op) {
+                for (int i = 0; i < count; i++) {
+                    if (expected[i] != actual[i] || signbit(expected[i]) != signbit(actual[i])) {
+                        cerr << kernels->name << " " << op << " mismatch at " << i << " of " << count << endl;
+                        failures++;
+                        return;
+                    }
+                }
+            };
+            reference.add(x.data(), y.data(), expected.data(), count);
+            kernels->add(x.data(), y.data(), actual.data(), count);
+            check("add");
+            reference.sub(x.data(), y.data(), expected.data(), count);
+            kernels->sub(x.data(), y.data(), actual.data(), count);
+            check("sub");
+            reference.neg(x.data(), expected.data(), count);
+            kernels->neg(x.data(), actual.data(), count);
+            check("neg");
+            reference.scale(-1.5, x.data(), expected.data(), count);
+            kernels->scale(-1.5, x.data(), actual.data(), count);
+            check("scale");
+
+            double magnitude = 0;  // Bound on the rounding error of either summation order
+            for (int i = 0; i < count; i++) magnitude += fabs(x[i] * y[i]);
+            double difference = fabs(reference.dot(x.data(), y.data(), count) - kernels->dot(x.data(), y.data(), count));
+            if (difference > 1e-14 * (count + 1) * magnitude) {
+                cerr << kernels->name << " dot mismatch for length " << count << ": " << difference << endl;
+                failures++;
+            }
+        }
+        // Batched products: a rounding bound again, since fused multiply-adds round once
+        const int shapes[][3] = {{1, 1, 1}, {3, 5, 2}, {4, 4, 4}, {8, 8, 1}};
+        for (const auto& shape : shapes) {
+            int rows = shape[0], depth = shape[1], cols = shape[2];
+            vector<double> A(rows * depth * BATCH_LANES), B(depth * cols * BATCH_LANES);
+            vector<double> expected(rows * cols * BATCH_LANES), actual(rows * cols * BATCH_LANES);
+            for (double& x : A) x = values(random);
+            for (double& x : B) x = values(random);
+            reference.batchGemm(rows, depth, cols, A.data(), B.data(), expected.data());
+            kernels->batchGemm(rows, depth, cols, A.data(), B.data(), actual.data());
+            for (size_t e = 0; e < expected.size(); e++) {
+                if (fabs(expected[e] - actual[e]) > 1e-12 * depth * 100 * 100) {
+                    cerr << kernels->name << " batch mismatch for " << rows << "x" << depth << "x" << cols << endl;
+                    failures++;
+                    break;
+                }
+            }
+        }
+        // Packed GEMM tiles, full and trimmed, with odd and even depths
+        const int tiles[][3] = {{GEMM_MR, GEMM_NR, 1}, {GEMM_MR, GEMM_NR, 256}, {3, 5, 7}, {1, 8, 64}, {4, 1, 33}};
+        for (const auto& tile : tiles) {
+            int rows = tile[0], cols = tile[1], kc = tile[2], ldc = GEMM_NR + 3;
+            vector<double> a(GEMM_MR * kc), b(kc * GEMM_NR), expected(GEMM_MR * ldc), actual;
+            for (double& x : a) x = values(random);
+            for (double& x : b) x = values(random);
+            for (double& x : expected) x = values(random);
+            actual = expected;
+            reference.gemmKernel(kc, -0.5, a.data(), b.data(), expected.data(), ldc, rows, cols);
+            kernels->gemmKernel(kc, -0.5, a.data(), b.data(), actual.data(), ldc, rows, cols);
+            for (size_t e = 0; e < expected.size(); e++) {
+                if (fabs(expected[e] - actual[e]) > 1e-12 * kc * 100 * 100) {
+                    cerr << kernels->name << " gemm tile mismatch for " << rows << "x" << cols << "x" << kc << endl;
+                    failures++;
+                    break;
+                }
+            }
+        }
+        cout << kernels->name << ": checked" << endl;
+    }
+    cout << (failures == 0 ? "All kernels match the scalar results" : "Kernel mismatches found") << endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// Check the blocked products against a plain triple loop on shapes that are not
+// multiples of the micro-kernel tile or of any block size, including ones that cross
+// GEMM_MC, GEMM_KC and GEMM_NC. gemm and parallelGemm run with alpha != 1 on padded,
+// non-zero C; the matrix product operator runs on 1 and 3 threads. Returns 0 when
+// every element is within the rounding bound of both summation orders.
+int runGemmTest() {
+    mt19937 random(4321);
+    uniform_real_distribution<double> values(-1.0, 1.0);
+    const int shapes[][3] = {{1, 1, 1}, {3, 5, 7}, {33, 35, 37}, {97, 101, 259}, {193, 67, 517},
+                             {13, 2061, 5}, {101, 2053, 263}};  // rows, cols, depth
+    const double alpha = -0.75, epsilon = numeric_limits<double>::epsilon();
+    int savedThreads = matrixThreads();
+    int failures = 0;
+    for (const auto& shape : shapes) {
+        int rows = shape[0], cols = shape[1], depth = shape[2];
+        int lda = depth + 3, ldb = cols + 5, ldc = cols + 1;
+        vector<double> A((size_t)rows * lda), B((size_t)depth * ldb), C((size_t)rows * ldc);
+        for (double& x : A) x = values(random);
+        for (double& x : B) x = values(random);
+        for (double& x : C) x = values(random);
+
+        // Reference A * B and sums of |a * b|, which bound the rounding error of any order
+        vector<double> products((size_t)rows * cols), magnitudes((size_t)rows * cols);
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < cols; j++) {
+                double sum = 0, absSum = 0;
+                for (int k = 0; k < depth; k++) {
+                    sum += A[(size_t)i * lda + k] * B[(size_t)k * ldb + j];
+                    absSum += fabs(A[(size_t)i * lda + k] * B[(size_t)k * ldb + j]);
+                }
+                products[(size_t)i * cols + j] = sum;
+                magnitudes[(size_t)i * cols + j] = absSum;
+            }
+        // actual holds C + alpha * A * B when accumulated, A * B otherwise
+        auto check = [&](const char* path, const double* actual, int stride, bool accumulated) {
+            for (int i = 0; i < rows; i++)
+                for (int j = 0; j < cols; j++) {
+                    double c = accumulated ? C[(size_t)i * ldc + j] : 0.0, scale = accumulated ? alpha : 1.0;
+                    double want = c + scale * products[(size_t)i * cols + j];
+                    double bound = 2 * (depth + 2) * epsilon * (fabs(c) + fabs(scale) * magnitudes[(size_t)i * cols + j]);
+                    if (fabs(actual[(size_t)i * stride + j] - want) > bound) {
+                        cerr << path << " mismatch for " << rows << "x" << cols << "x" << depth
+                             << " at (" << i << ", " << j << ")" << endl;
+                        failures++;
+                        return;
+                    }
+                }
+        };
+
+        vector<double> actual(C);
+        gemm(rows, cols, depth, alpha, A.data(), lda, B.data(), ldb, actual.data(), ldc);
+        check("gemm", actual.data(), ldc, true);
+        setMatrixThreads(3);
+        actual = C;
+        parallelGemm(rows, cols, depth, alpha, A.data(), lda, B.data(), ldb, actual.data(), ldc);
+        check("parallelGemm", actual.data(), ldc, true);
+
+        matr left(rows, depth), right(depth, cols);
+        for (int i = 0; i < rows; i++) copy(&A[(size_t)i * lda], &A[(size_t)i * lda] + depth, left.data() + (size_t)i * depth);
+        for (int k = 0; k < depth; k++) copy(&B[(size_t)k * ldb], &B[(size_t)k * ldb] + cols, right.data() + (size_t)k * cols);
+        for (int threads : {1, 3}) {
+            setMatrixThreads(threads);
+            matr product = left * right;
+            check("operator*", product.data(), cols, false);
+        }
+        setMatrixThreads(savedThreads);
+    }
+    cout << (failures == 0 ? "All products match the reference" : "Product mismatches found") << endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// Throughput of every supported kernel set on vectors of the given length,
+// in millions of elements per second. Prints CSV.
+void runSimdBenchmark(int count) {
+    vector<double> x(count, 1.5), y(count, 2.5), out(count);
+    long long repeats = max(1LL, 200000000LL / max(count, 1));
+    double sink = 0;  // Keeps the dot products alive
+    cout << "isa,op,elements,melems_per_sec" << endl;
+    for (const SimdKernels* kernels : supportedSimdKernels()) {
+        auto report = [&](const char* op, double seconds) {
+            cout << kernels->name << "," << op << "," << count << "," << (double)count * repeats / seconds / 1e6 << endl;
+        };
+        report("add", timeSeconds([&]() { for (long long r = 0; r < repeats; r++) kernels->add(x.data(), y.data(), out.data(), count); }));
+        report("sub", timeSeconds([&]() { for (long long r = 0; r < repeats; r++) kernels->sub(x.data(), y.data(), out.data(), count); }));
+        report("neg", timeSeconds([&]() { for (long long r = 0; r < repeats; r++) kernels->neg(x.data(), out.data(), count); }));
+        report("scale", timeSeconds([&]() { for (long long r = 0; r < repeats; r++) kernels->scale(1.0001, x.data(), out.data(), count); }));
+        report("dot", timeSeconds([&]() { for (long long r = 0; r < repeats; r++) sink += kernels->dot(x.data(), y.data(), count); }));
+    }
+    if (sink == 42) cout << out[0] << endl;
+}
+
+// Single-threaded GEMM throughput against the peak of the micro-kernel: the kernel
+// alone on one packed GEMM_KC-deep sliver pair, which stays in L1, and then gemm on
+// square matrices up to size, in GFLOPS and percent of that peak. Prints CSV.
+void runGemmBenchmark(int size) {
+    mt19937 random(17);
+    uniform_real_distribution<double> values(-1.0, 1.0);
+    const SimdKernels& kernels = simd();
+    vector<double> a(GEMM_MR * GEMM_KC), b(GEMM_KC * GEMM_NR), tile(GEMM_MR * GEMM_NR, 0.0);
+    for (double& x : a) x = values(random);
+    for (double& x : b) x = values(random);
+    const long long KERNEL_CALLS = 200000;
+    double kernelSeconds = 1e30;
+    for (int attempt = 0; attempt < 3; attempt++) {  // Best of three
+        kernelSeconds = min(kernelSeconds, timeSeconds([&]() {
+            for (long long r = 0; r < KERNEL_CALLS; r++)
+                kernels.gemmKernel(GEMM_KC, 1e-9, a.data(), b.data(), tile.data(), GEMM_NR, GEMM_MR, GEMM_NR);
+        }));
+    }
+    double peak = 2.0 * GEMM_MR * GEMM_NR * GEMM_KC * KERNEL_CALLS / kernelSeconds / 1e9;
+    cout << "isa,what,size,seconds,gflops,percent_of_kernel" << endl;
+    cout << kernels.name << ",kernel," << GEMM_KC << "," << kernelSeconds << "," << peak << ",100" << endl;
+
+    vector<int> sizes;
+    for (int n = 256; n < size; n *= 2) sizes.push_back(n);
+    sizes.push_back(size);
+    for (int n : sizes) {
+        vector<double> A((size_t)n * n), B((size_t)n * n), C((size_t)n * n);
+        for (double& x : A) x = values(random);
+        for (double& x : B) x = values(random);
+        double seconds = 1e30;
+        for (int attempt = 0; attempt < 3; attempt++) {
+            fill(C.begin(), C.end(), 0.0);
+            seconds = min(seconds, timeSeconds([&]() { gemm(n, n, n, 1.0, A.data(), n, B.data(), n, C.data(), n); }));
+        }
+        double gflops = 2.0 * n * n * (double)n / seconds / 1e9;
+        cout << kernels.name << ",gemm," << n << "," << seconds << "," << gflops << "," << 100 * gflops / peak << endl;
+    }
+    if (tile[0] == 42) cout << tile[0] << endl;  // Keeps the kernel calls alive
+}
+
+// Time square matrix products and matrix-vector products on 1 to maxThreads threads
+// and check that every thread count gives bit-identical results. Prints CSV.
+void runThreadScalingBenchmark(int size, int maxThreads) {
+    mt19937 random(7);
+    uniform_real_distribution<double> values(-1.0, 1.0);
+    matr left(size, size), right(size, size);
+    vect v(size);
+    for (int i = 0; i < size * size; i++) {
+        left.data()[i] = values(random);
+        right.data()[i] = values(random);
+    }
+    for (int i = 0; i < size; i++) v.set(i, values(random));
+
+    const int MATVEC_REPEATS = 20;
+    matr expectedProduct;
+    vect expectedImage;
+    double serialGemm = 0, serialMatvec = 0;
+    cout << "threads,gemm_seconds,gflops,gemm_speedup,matvec_seconds,matvec_speedup,identical" << endl;
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        setMatrixThreads(threads);
+        matr product;
+        vect image;
+        double gemmSeconds = 1e30, matvecSeconds = 1e30;
+        for (int attempt = 0; attempt < 3; attempt++) {  // Best of three
+            gemmSeconds = min(gemmSeconds, timeSeconds([&]() { product = left * right; }));
+            matvecSeconds = min(matvecSeconds, timeSeconds([&]() {
+                for (int r = 0; r < MATVEC_REPEATS; r++) image = left * v;
+            }));
+        }
+        if (threads == 1) {
+            expectedProduct = product;
+            expectedImage = image;
+            serialGemm = gemmSeconds;
+            serialMatvec = matvecSeconds;
+        }
+        bool identical = equal(product.data(), product.data() + size * size, expectedProduct.data()) &&
+                         equal(image.data(), image.data() + size, expectedImage.data());
+        cout << threads << "," << gemmSeconds << "," << 2.0 * size * size * size / gemmSeconds / 1e9 << ","
+             << serialGemm / gemmSeconds << "," << matvecSeconds << "," << serialMatvec / matvecSeconds << ","
+             << (identical ? "yes" : "no") << endl;
+    }
+}
+
+// Largest absolute difference between two equally sized buffers
+static double maxDifference(const double* x, const double* y, long long count) {
+    double res = 0;
+    for (long long i = 0; i < count; i++) res = max(res, fabs(x[i] - y[i]));
+    return res;
+}
+
+// Compare CSR and dense storage of a random size x size matrix with the given fraction
+// of nonzeros: memory, matrix-vector time and agreement of every sparse operation with
+// its dense counterpart. Prints CSV.
+void runSparseBenchmark(int size, double density) {
+    mt19937 random(11);
+    uniform_real_distribution<double> values(-1.0, 1.0);
+    uniform_int_distribution<int> positions(0, size - 1);
+    long long entries = (long long)(density * size * size);
+    coo first(size, size), second(size, size);
+    first.reserve(entries);
+    second.reserve(entries);
+    for (long long e = 0; e < entries; e++) {
+        first.add(positions(random), positions(random), values(random));
+        second.add(positions(random), positions(random), values(random));
+    }
+    spmatr sparse(first), other(second);
+    matr dense = sparse.toDense(), otherDense = other.toDense();
+    vect v(size);
+    for (int i = 0; i < size; i++) v.set(i, values(random));
+
+    const int REPEATS = 20;
+    vect sparseImage, denseImage;
+    double sparseSeconds = timeSeconds([&]() { for (int r = 0; r < REPEATS; r++) sparseImage = sparse * v; });
+    double denseSeconds = timeSeconds([&]() { for (int r = 0; r < REPEATS; r++) denseImage = dense * v; });
+
+    matr sumDense = dense + otherDense;
+    matr sparseSum = (sparse + other).toDense();
+    const int DENSE_COLS = 16;  // Width of the dense right-hand side
+    matr right(size, DENSE_COLS);
+    for (int i = 0; i < size * DENSE_COLS; i++) right.data()[i] = values(random);
+    matr sparseProduct = sparse * right;
+    matr denseProduct = dense * right;
+
+    cout << "size,nonzeros,csr_bytes,dense_bytes,spmv_seconds,dense_matvec_seconds,speedup,"
+            "matvec_error,sum_error,product_error" << endl;
+    cout << size << "," << sparse.nnz() << "," << sparse.bytes() << "," << (long long)size * size * sizeof(double) << ","
+         << sparseSeconds / REPEATS << "," << denseSeconds / REPEATS << "," << denseSeconds / sparseSeconds << ","
+         << maxDifference(sparseImage.data(), denseImage.data(), size) << ","
+         << maxDifference(sparseSum.data(), sumDense.data(), (long long)size * size) << ","
+         << maxDifference(sparseProduct.data(), denseProduct.data(), (long long)size * DENSE_COLS) << endl;
+}
+
+// Time 3-vector arithmetic and 4x4 matrix products with the dynamic and the fixed-size
+// types, and check that both give the same results. Prints CSV.
+void runFixedSizeBenchmark(int iterations) {
+    vect a(3), b(3), c(3);
+    matr left(4, 4), right(4, 4);
+    fvect<3> fa(0.5, 1.5, 2.5), fb(3, -1, 2), fc(1, 1, -2);
+    fmatr<4, 4> fleft, fright = 0.5 * fmatr<4, 4>::identity();
+    for (int k = 0; k < 16; k++) fleft(k / 4, k % 4) = k - 7.5;
+    for (int i = 0; i < 3; i++) {
+        a.set(i, fa[i]);
+        b.set(i, fb[i]);
+        c.set(i, fc[i]);
+    }
+    left = fleft;
+    right = fright;
+
+    double dynamicSum = 0, fixedSum = 0;
+    double dynamicSeconds = timeSeconds([&]() {
+        for (int r = 0; r < iterations; r++) {
+            a.set(0, r * 1e-9);  // Changes every iteration so nothing is hoisted
+            vect v = 2.0 * a + b - c;
+            dynamicSum += v * c;
+            left.set(0, 0, r * 1e-9);
+            matr product = left * right;
+            dynamicSum += product.get(3, 3);
+        }
+    });
+    double fixedSeconds = timeSeconds([&]() {
+        for (int r = 0; r < iterations; r++) {
+            fa[0] = r * 1e-9;
+            fvect<3> v = 2.0 * fa + fb - fc;
+            fixedSum += v * fc;
+            fleft(0, 0) = r * 1e-9;
+            fmatr<4, 4> product = fleft * fright;
+            fixedSum += product(3, 3);
+        }
+    });
+    cout << "iterations,dynamic_seconds,fixed_seconds,speedup,same_result" << endl;
+    cout << iterations << "," << dynamicSeconds << "," << fixedSeconds << "," << dynamicSeconds / fixedSeconds << ","
+         << (dynamicSum == fixedSum ? "yes" : "no") << endl;
+}
+
+// Factorize a random size x size matrix, solve one system with it and invert a smaller
+// one, reporting speed and accuracy. Prints CSV.
+void runLuBenchmark(int size) {
+    mt19937 random(5);
+    uniform_real_distribution<double> values(-1.0, 1.0);
+    matr A(size, size);
+    vect b(size);
+    for (int i = 0; i < size * size; i++) A.data()[i] = values(random);
+    for (int i = 0; i < size; i++) b.set(i, values(random));
+
+    ludecomp* lu = nullptr;
+    double factorSeconds = timeSeconds([&]() { lu = new ludecomp(A); });
+    vect x;
+    double solveSeconds = timeSeconds([&]() { x = lu->solve(b); });
+    delete lu;
+
+    // Scaled residual |A x - b| / (|A| |x|) in the max norm; around 1e-16 * size is backward stable
+    vect residual = A * x - b;
+    double residualNorm = 0, matrixNorm = 0, solutionNorm = 0;
+    for (int i = 0; i < size; i++) {
+        residualNorm = max(residualNorm, fabs(residual.get(i)));
+        solutionNorm = max(solutionNorm, fabs(x.get(i)));
+        double rowSum = 0;
+        for (int j = 0; j < size; j++) rowSum += fabs(A.get(i, j));
+        matrixNorm = max(matrixNorm, rowSum);
+    }
+
+    int small = min(size, 256);
+    matr S(small, small);
+    for (int i = 0; i < small * small; i++) S.data()[i] = values(random);
+    matr inverse = S.inverse();
+    matr check = S * inverse;
+    double inverseError = 0;
+    for (int i = 0; i < small; i++)
+        for (int j = 0; j < small; j++) inverseError = max(inverseError, fabs(check.get(i, j) - (i == j ? 1.0 : 0.0)));
+
+    cout << "size,factor_seconds,gflops,solve_seconds,scaled_residual,inverse_size,inverse_error" << endl;
+    cout << size << "," << factorSeconds << "," << 2.0 / 3.0 * size * size * (double)size / factorSeconds / 1e9 << ","
+         << solveSeconds << "," << residualNorm / (matrixNorm * solutionNorm) << "," << small << "," << inverseError << endl;
+}
+
+// Largest resident set size of the process so far, in kilobytes
+long peakRssKilobytes() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // Reported in bytes there
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// Restart the peak reported by peakRssKilobytes from the current resident set size.
+// Only Linux supports it; returns false elsewhere.
+bool resetPeakRss() {
+#ifdef __linux__
+    ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.close();
+    return (bool)clearRefs;
+#else
+    return false;
+#endif
+}
+
+// Element (i, j) of the generated test matrices; small integers keep every product exact
+static double outOfCoreValue(int i, int j, int seed) { return (double)((i * 31 + j * 17 + seed) % 19) - 9.0; }
+
+// Fill a new matrix file row by row without keeping it resident
+static bool writeTestMatrix(const string& filename, int rows, int cols, int seed) {
+    mappedmatr mat;
+    if (!mat.create(filename, rows, cols)) return false;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) mat.set(i, j, outOfCoreValue(i, j, seed));
+        if (i % 64 == 63 || i == rows - 1) {  // Release every 64 finished rows
+            size_t bandStart = (size_t)(i / 64) * 64 * cols;
+            mat.release(bandStart, (size_t)(i + 1) * cols - bandStart);
+        }
+    }
+    return true;
+}
+
+// Multiply and add two size x size matrix files whose size exceeds a memory budget of
+// budgetKilobytes, then check sampled elements of the results against products and sums
+// computed directly from the inputs. Returns 0 when every sample matches and the
+// resident set grew by at most the budget while multiplying and adding.
+int runOutOfCoreTest(int size, size_t budgetKilobytes) {
+    const string fileA = "lab2_a.matrix", fileB = "lab2_b.matrix";
+    const string product = "lab2_product.matrix", sum = "lab2_sum.matrix";
+    size_t budget = budgetKilobytes * 1024;
+    if (!writeTestMatrix(fileA, size, size, 1) || !writeTestMatrix(fileB, size, size, 5)) return 1;
+
+    mappedmatr A, B, C, S;
+    if (!A.open(fileA) || !B.open(fileB)) return 1;
+    cout << "Each input: " << A.elementBytes() / 1024 << " KB, memory budget: " << budgetKilobytes << " KB" << endl;
+    if (A.elementBytes() <= budget) cout << "Warning: the inputs fit in the budget" << endl;
+
+    // Growth of the resident set over its size before each operation, which includes
+    // what earlier operations keep (such as the gemm packing buffers)
+    bool peakReset = true;
+    auto measure = [&](long& growthKilobytes, auto work) {
+        peakReset = resetPeakRss() && peakReset;
+        long baselineKilobytes = peakRssKilobytes();
+        double seconds = timeSeconds(work);
+        growthKilobytes = peakRssKilobytes() - baselineKilobytes;
+        return seconds;
+    };
+    long multiplyKilobytes = 0, addKilobytes = 0;
+    double multiplySeconds = measure(multiplyKilobytes, [&]() { tiledMultiply(A, B, product, budget); });
+    double addSeconds = measure(addKilobytes, [&]() { tiledAdd(A, B, sum, budget); });
+    if (!C.open(product) || !S.open(sum)) return 1;
+
+    mt19937 random(3);
+    uniform_int_distribution<int> positions(0, size - 1);
+    int failures = 0;
+    for (int sample = 0; sample < 200; sample++) {
+        int i = positions(random), j = positions(random);
+        double expected = 0;
+        for (int k = 0; k < size; k++) expected += A.get(i, k) * B.get(k, j);
+        if (C.get(i, j) != expected || S.get(i, j) != A.get(i, j) + B.get(i, j)) {
+            cerr << "Mismatch at (" << i << ", " << j << ")" << endl;
+            failures++;
+        }
+    }
+    cout << "Multiply: " << multiplySeconds << " s, RSS growth " << multiplyKilobytes << " KB; add: "
+         << addSeconds << " s, RSS growth " << addKilobytes << " KB" << endl;
+    cout << (failures == 0 ? "Out-of-core results match" : "Out-of-core results differ") << endl;
+    bool withinBudget = max(multiplyKilobytes, addKilobytes) <= (long)budgetKilobytes;
+    if (!peakReset)
+        cout << "Warning: the peak RSS cannot be reset here, so the budget is not checked" << endl;
+    else if (!withinBudget)
+        cerr << "Error: the resident set grew by more than the budget" << endl;
+
+    A.close();
+    B.close();
+    C.close();
+    S.close();
+    for (const string& filename : {fileA, fileB, product, sum}) remove(filename.c_str());
+    return failures == 0 && (withinBudget || !peakReset) ? 0 : 1;
+}
+
+// Throughput of many independent small products: one matr product per pair, the
+// batched call on plain arrays, and the batched call on interleaved batches, in
+// millions of products per second. Prints CSV.
+void runBatchBenchmark(int count) {
+    mt19937 random(9);
+    uniform_real_distribution<double> values(-1.0, 1.0);
+    const int shapes[][3] = {{4, 4, 4}, {4, 4, 1}, {8, 8, 8}, {8, 8, 1}};  // rows, depth, cols
+    cout << "shape,method,products,seconds,mproducts_per_sec,max_error" << endl;
+    for (const auto& shape : shapes) {
+        int rows = shape[0], depth = shape[1], cols = shape[2];
+        vector<double> A((size_t)count * rows * depth), B((size_t)count * depth * cols);
+        vector<double> expected((size_t)count * rows * cols), C(expected.size());
+        for (double& x : A) x = values(random);
+        for (double& x : B) x = values(random);
+        string name = to_string(rows) + "x" + to_string(depth) + (cols == 1 ? "*vect" : "*" + to_string(depth) + "x" + to_string(cols));
+        auto report = [&](const char* method, double seconds, const vector<double>& result) {
+            cout << name << "," << method << "," << count << "," << seconds << "," << count / seconds / 1e6 << ","
+                 << maxDifference(result.data(), expected.data(), (long long)result.size()) << endl;
+        };
+
+        // One heap-allocated product per pair, as with plain matr/vect code
+        double objectSeconds = timeSeconds([&]() {
+            matr a(rows, depth), b(depth, cols);
+            vect v(depth);
+            for (int p = 0; p < count; p++) {
+                copy(A.begin() + (size_t)p * rows * depth, A.begin() + (size_t)(p + 1) * rows * depth, a.data());
+                if (cols == 1) {
+                    copy(B.begin() + (size_t)p * depth, B.begin() + (size_t)(p + 1) * depth, v.data());
+                    vect r = a * v;
+                    copy(r.data(), r.data() + rows, expected.begin() + (size_t)p * rows);
+                } else {
+                    copy(B.begin() + (size_t)p * depth * cols, B.begin() + (size_t)(p + 1) * depth * cols, b.data());
+                    matr r = a * b;
+                    copy(r.data(), r.data() + rows * cols, expected.begin() + (size_t)p * rows * cols);
+                }
+            }
+        });
+        report("matr", objectSeconds, expected);
+
+        double arraySeconds = timeSeconds([&]() { batchMultiply(A.data(), B.data(), C.data(), count, rows, depth, cols); });
+        report("batch_array", arraySeconds, C);
+
+        matrbatch batchA = matrbatch::fromArray(A.data(), count, rows, depth);
+        matrbatch batchB = matrbatch::fromArray(B.data(), count, depth, cols);
+        matrbatch batchC(count, rows, cols);  // Allocated and zeroed outside the timing, like C
+        double interleavedSeconds = timeSeconds([&]() { batchMultiply(batchA, batchB, batchC); });
+        batchC.toArray(C.data());
+        report("batch_interleaved", interleavedSeconds, C);
+    }
+}
+
+// Main function demonstrating vector and matrix operations
+int main(int argc, char* argv[]) {
+    // Optional modes: "simd-test" checks every supported SIMD kernel set against the
+    // scalar one, "simd-bench [elements]" reports their throughput, and
+    // "gemm-test" checks the blocked products against a plain triple loop, and
+    // "bench-gemm [size]" compares single-threaded gemm with the micro-kernel peak, and
+    // "bench-threads [size] [max threads]" measures multi-threaded products and
+    // "bench-sparse [size] [density]" compares CSR with dense storage, and
+    // "bench-fixed [iterations]" compares fixed-size with dynamic types, and
+    // "bench-lu [size]" times the LU decomposition and checks its accuracy, and
+    // "test-out-of-core [size] [budget KB]" multiplies matrix files larger than the budget,
+    // and "bench-batch [count]" measures batched small products
+    if (argc > 1) {
+        string mode = argv[1];
+        if (mode == "simd-test") return runSimdTest();
+        if (mode == "gemm-test") return runGemmTest();
+        if (mode == "bench-gemm") {
+            runGemmBenchmark(argc > 2 ? stoi(argv[2]) : 1024);
+            return 0;
+        }
+        if (mode == "simd-bench") {
+            runSimdBenchmark(argc > 2 ? stoi(argv[2]) : 4096);
+            return 0;
+        }
+        if (mode == "bench-sparse") {
+            runSparseBenchmark(argc > 2 ? stoi(argv[2]) : 4000, argc > 3 ? stod(argv[3]) : 0.005);
+            return 0;
+        }
+        if (mode == "bench-fixed") {
+            runFixedSizeBenchmark(argc > 2 ? stoi(argv[2]) : 1000000);
+            return 0;
+        }
+        if (mode == "bench-lu") {
+            runLuBenchmark(argc > 2 ? stoi(argv[2]) : 2048);
+            return 0;
+        }
+        if (mode == "test-out-of-core") {
+            return runOutOfCoreTest(argc > 2 ? stoi(argv[2]) : 2048, argc > 3 ? stoul(argv[3]) : 4096);
+        }
+        if (mode == "bench-batch") {
+            runBatchBenchmark(argc > 2 ? stoi(argv[2]) : 200000);
+            return 0;
+        }
+        if (mode == "bench-threads") {
+            runThreadScalingBenchmark(argc > 2 ? stoi(argv[2]) : 1024,
+                                      argc > 3 ? stoi(argv[3]) : max(1, (int)thread::hardware_concurrency()));
+            return 0;
+        }
+        cerr << "Unknown mode " << mode << endl;
+        return 1;
+    }
+
+    cout << "=== Vector demonstration ===" << endl;
+    // Create two 3D vectors
+    vect v1(3), v2(3);
+    // Set vector elements
+    v1.set(0, 1); v1.set(1, 2); v1.set(2, 3);
+    v2.set(0, 4); v2.set(1, 5); v2.set(2, 6);
 
     cout << "\nInitial vectors:" << endl;
     v1.print();  // Print first vector
@@ -346,5 +2727,15 @@ int main() {
     vect v7 = m1 * v1;  // Matrix-vector product
     v7.print();
 
+    if (Lifecycle::COUNT) {
+        auto report = [](const char* what, LifecycleStats stats) {
+            cout << what << ": " << stats.creations << " created, " << stats.copies << " copies, "
+                 << stats.moves << " moves, " << stats.bytes << " bytes allocated" << endl;
+        };
+        cout << "\nLifecycle counters:" << endl;
+        report("Vectors", vect::lifecycleStats());
+        report("Matrices", matr::lifecycleStats());
+    }
+
     return 0;
 }
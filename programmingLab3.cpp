@@ -1,11 +1,61 @@
 #include <iostream>   // Include library for input/output operations (cout, cin)
 #include <cmath>      // Include math functions like sin, cos for rotation calculations
+#include <vector>     // Contiguous coordinate buffers of ShapeBatch
+#include <memory>     // unique_ptr for shapes rebuilt from a batch
+#include <string>     // Program mode names
+#include <chrono>     // Benchmark timing
+#include <cstddef>    // size_t
+#include <algorithm>  // std::max
+#include <variant>    // Closed set of value shapes for static dispatch
+#include <thread>     // Worker threads of the scene pool
+#include <mutex>      // Locks of the scene pool
+#include <condition_variable> // Job start/finish signals of the scene pool
+#include <deque>      // Per-thread queues of chunked ranges
+#include <functional> // Type-erased range body of a parallel job
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // Start of user-defined namespace to avoid name collisions
 namespace usernamespace {
 
 const double PI = 3.1415926535; // Define constant Pi for angle calculations
 
+// 2x3 affine transform: x' = a*x + b*y + tx, y' = c*x + d*y + ty
+struct Affine {
+    double a = 1, b = 0, tx = 0;
+    double c = 0, d = 1, ty = 0;
+
+    bool isIdentity() const {
+        return a == 1 && b == 0 && tx == 0 && c == 0 && d == 1 && ty == 0;
+    }
+
+    // Follow this transform by a translation
+    void translate(double dx, double dy) {
+        tx += dx;
+        ty += dy;
+    }
+
+    // Follow this transform by another transform m
+    void then(const Affine& m) {
+        Affine t = *this;
+        a = m.a * t.a + m.b * t.c;   b = m.a * t.b + m.b * t.d;   tx = m.a * t.tx + m.b * t.ty + m.tx;
+        c = m.c * t.a + m.d * t.c;   d = m.c * t.b + m.d * t.d;   ty = m.c * t.tx + m.d * t.ty + m.ty;
+    }
+
+    // Follow this transform by a rotation around origin (0,0), same formula as Point::rotate
+    void rotate(double angleDegrees) {
+        double rad = angleDegrees * PI / 180.0;
+        double cs = cos(rad), sn = sin(rad);
+        Affine m = *this;
+        a = m.a * cs - m.c * sn;   b = m.b * cs - m.d * sn;   tx = m.tx * cs - m.ty * sn;
+        c = m.a * sn + m.c * cs;   d = m.b * sn + m.d * cs;   ty = m.tx * sn + m.ty * cs;
+    }
+};
+
 // Abstract base class representing a vertex (a point or similar element)
 class Vertex {
 public:
@@ -52,29 +102,112 @@ public:
         x = newX;                               // Update x coordinate
         y = newY;                               // Update y coordinate
     }
+
+    // Apply an accumulated affine transform to the point
+    void transform(const Affine& m) {
+        double newX = m.a * x + m.b * y + m.tx;
+        double newY = m.c * x + m.d * y + m.ty;
+        x = newX;
+        y = newY;
+    }
+};
+
+// Axis-aligned bounding box; an empty box has min > max
+struct Box {
+    double minX = 1e300, minY = 1e300;
+    double maxX = -1e300, maxY = -1e300;
+
+    Box() {}
+    Box(double minX, double minY, double maxX, double maxY)
+        : minX(minX), minY(minY), maxX(maxX), maxY(maxY) {}
+
+    // Grow the box to include a point / another box
+    void expand(const Point& p) {
+        minX = std::min(minX, p.getX()); maxX = std::max(maxX, p.getX());
+        minY = std::min(minY, p.getY()); maxY = std::max(maxY, p.getY());
+    }
+    void expand(const Box& b) {
+        minX = std::min(minX, b.minX); maxX = std::max(maxX, b.maxX);
+        minY = std::min(minY, b.minY); maxY = std::max(maxY, b.maxY);
+    }
+
+    bool contains(double x, double y) const {
+        return x >= minX && x <= maxX && y >= minY && y <= maxY;
+    }
+    bool intersects(const Box& b) const {
+        return minX <= b.maxX && b.minX <= maxX && minY <= b.maxY && b.minY <= maxY;
+    }
+    double centerX() const { return (minX + maxX) / 2; }
+    double centerY() const { return (minY + maxY) / 2; }
 };
 
 // Abstract base class for shapes (polygons, lines, etc.)
+// move and rotate only compose a pending affine transform in O(1); derived classes
+// apply it to their vertices on the next coordinate read (bake), so a chain of
+// transforms touches each vertex once and the baked vertices are reused until
+// the next move or rotate.
+// Because of this, a const read (draw, bounds, vertex accessors) of a shape with a
+// pending transform writes the shape and must not run concurrently with other
+// reads of it. Call bake() first to make later const reads pure reads;
+// ShapeIndex::build/refit and Scene::transformAll do so for the shapes they touch.
 class Shape {
+private:
+    mutable Affine pending;                 // Transform not yet applied to the vertices
+
+protected:
+    virtual void applyTransform(const Affine& m) const = 0; // Transform stored vertices - implemented by derived classes
+
 public:
     virtual void draw() const = 0;          // Draw the shape - must be implemented by derived classes
     virtual void erase() const = 0;         // Erase the shape - must be implemented
-    virtual void move(double dx, double dy) = 0;  // Move shape by dx, dy - must be implemented
-    virtual void rotate(double angle) = 0;  // Rotate shape by angle - must be implemented
+    virtual Box bounds() const = 0;         // Axis-aligned bounding box of the current vertices
     virtual ~Shape() {}                      // Virtual destructor for cleanup
+
+    // Move shape by dx, dy
+    virtual void move(double dx, double dy) {
+        pending.translate(dx, dy);
+    }
+
+    // Rotate shape around origin by angle degrees
+    virtual void rotate(double angle) {
+        pending.rotate(angle);
+    }
+
+    // Follow the current transform by an arbitrary affine transform
+    virtual void transform(const Affine& m) {
+        pending.then(m);
+    }
+
+    // Apply the pending transform to the vertices now
+    void bake() const {
+        if (pending.isIdentity()) return;
+        applyTransform(pending);
+        pending = Affine();
+    }
+
+    const Affine& pendingTransform() const { return pending; } // Transform waiting for the next bake
 };
 
 // Class representing a line, derived from Shape
 class Line : public Shape {
 private:
-    Point a, b;                             // Two endpoints of the line
+    mutable Point a, b;                     // Two endpoints of the line, current after bake()
+
+    void applyTransform(const Affine& m) const override {
+        a.transform(m);
+        b.transform(m);
+    }
 
 public:
     // Constructor initializes the line with two points a and b
     Line(Point a, Point b) : a(a), b(b) {}
 
+    Point getA() const { bake(); return a; } // Accessor for the first endpoint
+    Point getB() const { bake(); return b; } // Accessor for the second endpoint
+
     // Draw line by drawing its endpoints (simplified)
     void draw() const override {
+        bake();
         std::cout << "Line from "; a.draw();
         std::cout << " to "; b.draw();
     }
@@ -84,31 +217,43 @@ public:
         std::cout << "Line erased\n";
     }
 
-    // Move both endpoints by dx and dy
-    void move(double dx, double dy) override {
-        a.move(dx, dy);
-        b.move(dx, dy);
+    // Box spanned by the two endpoints
+    Box bounds() const override {
+        bake();
+        Box box;
+        box.expand(a);
+        box.expand(b);
+        return box;
     }
 
-    // Rotate both endpoints by given angle around origin
-    void rotate(double angle) override {
-        a.rotate(angle);
-        b.rotate(angle);
-    }
 };
 
 // Class for quadrilaterals, inherits from Shape
 class Quadrilateral : public Shape {
 protected:
-    Point p1, p2, p3, p4;                   // Four vertices of the quadrilateral
+    mutable Point p1, p2, p3, p4;           // Four vertices of the quadrilateral, current after bake()
+
+    void applyTransform(const Affine& m) const override {
+        p1.transform(m);
+        p2.transform(m);
+        p3.transform(m);
+        p4.transform(m);
+    }
 
 public:
     // Constructor initializes four points of the quadrilateral
     Quadrilateral(Point a, Point b, Point c, Point d)
         : p1(a), p2(b), p3(c), p4(d) {}
 
+    // Accessor for vertex 0..3 in construction order
+    Point getVertex(int i) const {
+        bake();
+        return i == 0 ? p1 : i == 1 ? p2 : i == 2 ? p3 : p4;
+    }
+
     // Draw all four vertices
     void draw() const override {
+        bake();
         std::cout << "Figure with vertices:\n";
         p1.draw(); p2.draw(); p3.draw(); p4.draw();
     }
@@ -118,20 +263,12 @@ public:
         std::cout << "Figure erased\n";
     }
 
-    // Move all four points by dx and dy
-    void move(double dx, double dy) override {
-        p1.move(dx, dy);
-        p2.move(dx, dy);
-        p3.move(dx, dy);
-        p4.move(dx, dy);
-    }
-
-    // Rotate all four points around origin by angle degrees
-    void rotate(double angle) override {
-        p1.rotate(angle);
-        p2.rotate(angle);
-        p3.rotate(angle);
-        p4.rotate(angle);
+    // Box spanned by the four vertices
+    Box bounds() const override {
+        bake();
+        Box box;
+        box.expand(p1); box.expand(p2); box.expand(p3); box.expand(p4);
+        return box;
     }
 };
 
@@ -145,6 +282,9 @@ public:
             Point(origin.getX() + size, origin.getY()),
             Point(origin.getX() + size, origin.getY() + size),
             Point(origin.getX(), origin.getY() + size)) {}
+
+    // Constructor from four vertices that already form a square (e.g. after a rotation)
+    Square(Point a, Point b, Point c, Point d) : Quadrilateral(a, b, c, d) {}
 };
 
 // Rectangle class derived from Quadrilateral
@@ -157,6 +297,9 @@ public:
             Point(origin.getX() + width, origin.getY()),
             Point(origin.getX() + width, origin.getY() + height),
             Point(origin.getX(), origin.getY() + height)) {}
+
+    // Constructor from four vertices that already form a rectangle (e.g. after a rotation)
+    Rectangle(Point a, Point b, Point c, Point d) : Quadrilateral(a, b, c, d) {}
 };
 
 // Parallelogram class inherits Square virtually and redefines vertices
@@ -170,14 +313,909 @@ public:
               Point(origin.getX() + base, origin.getY()),
               Point(origin.getX() + base + offset, origin.getY() + height),
               Point(origin.getX() + offset, origin.getY() + height)) {}
+
+    // Constructor from four vertices that already form a parallelogram (e.g. after a rotation)
+    Parallelogram(Point a, Point b, Point c, Point d)
+        : Quadrilateral(a, b, c, d), Square(a, b, c, d) {}
+};
+
+// Container that stores the vertices of many shapes in struct-of-arrays form: all x
+// coordinates in one contiguous buffer, all y coordinates in another, and per shape
+// its kind and the offset of its first vertex. move and rotate then transform every
+// vertex of every shape in one SIMD pass, with sin/cos computed once per call instead
+// of twice per vertex.
+class ShapeBatch {
+public:
+    enum class Kind { Line, Quadrilateral, Square, Rectangle, Parallelogram, None };  // None: no such shape
+
+private:
+    struct Entry {
+        Kind kind;                          // Shape type to rebuild
+        size_t first;                       // Index of the first vertex in xs/ys
+        int count;                          // Number of vertices (2 or 4)
+    };
+
+    std::vector<double> xs, ys;             // Vertex coordinates of all shapes
+    std::vector<Entry> entries;             // One entry per shape, in insertion order
+
+    void addQuadrilateral(Kind kind, const Quadrilateral& q) {
+        entries.push_back({kind, xs.size(), 4});
+        for (int i = 0; i < 4; i++) {
+            xs.push_back(q.getVertex(i).getX());
+            ys.push_back(q.getVertex(i).getY());
+        }
+    }
+
+    Point vertex(size_t shape, int i) const {
+        size_t k = entries[shape].first + i;
+        return Point(xs[k], ys[k]);
+    }
+
+    // Report an index past the end; returns false so callers can fall back
+    bool inRange(size_t shape) const {
+        if (shape < entries.size()) return true;
+        std::cerr << "Error: shape " << shape << " is out of range (" << entries.size() << " shapes)\n";
+        return false;
+    }
+
+    // Report a view of the wrong type; returns false so callers can fall back.
+    // Any four-vertex shape can be viewed as a Quadrilateral, other views need the exact kind.
+    bool check(size_t shape, Kind kind, const char* what) const {
+        if (!inRange(shape)) return false;
+        const Entry& e = entries[shape];
+        if (e.kind == kind || (kind == Kind::Quadrilateral && e.count == 4)) return true;
+        std::cerr << "Error: shape " << shape << " is not a " << what << "\n";
+        return false;
+    }
+
+public:
+    // Reserve room for the given number of shapes and vertices
+    void reserve(size_t shapes, size_t vertices) {
+        entries.reserve(shapes);
+        xs.reserve(vertices);
+        ys.reserve(vertices);
+    }
+
+    // Copy a shape into the batch
+    void add(const Line& l) {
+        entries.push_back({Kind::Line, xs.size(), 2});
+        xs.push_back(l.getA().getX()); ys.push_back(l.getA().getY());
+        xs.push_back(l.getB().getX()); ys.push_back(l.getB().getY());
+    }
+    void add(const Quadrilateral& q) { addQuadrilateral(Kind::Quadrilateral, q); }
+    void add(const Square& q) { addQuadrilateral(Kind::Square, q); }
+    void add(const Rectangle& q) { addQuadrilateral(Kind::Rectangle, q); }
+    void add(const Parallelogram& q) { addQuadrilateral(Kind::Parallelogram, q); }
+
+    size_t size() const { return entries.size(); }          // Number of shapes
+    size_t vertexCount() const { return xs.size(); }        // Number of vertices of all shapes
+    Kind kindAt(size_t shape) const { return inRange(shape) ? entries[shape].kind : Kind::None; }
+    const double* xData() const { return xs.data(); }       // All x coordinates
+    const double* yData() const { return ys.data(); }       // All y coordinates
+
+    // Move every shape by dx and dy
+    void move(double dx, double dy) {
+        size_t n = xs.size(), i = 0;
+        double* x = xs.data();
+        double* y = ys.data();
+#if defined(__AVX2__)
+        const __m256d vdx = _mm256_set1_pd(dx), vdy = _mm256_set1_pd(dy);
+        for (; i + 4 <= n; i += 4) {
+            _mm256_storeu_pd(x + i, _mm256_add_pd(_mm256_loadu_pd(x + i), vdx));
+            _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), vdy));
+        }
+#elif defined(__SSE2__)
+        const __m128d vdx = _mm_set1_pd(dx), vdy = _mm_set1_pd(dy);
+        for (; i + 2 <= n; i += 2) {
+            _mm_storeu_pd(x + i, _mm_add_pd(_mm_loadu_pd(x + i), vdx));
+            _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), vdy));
+        }
+#endif
+        for (; i < n; i++) {
+            x[i] += dx;
+            y[i] += dy;
+        }
+    }
+
+    // Rotate every shape around origin (0,0) by angleDegrees, same formula as Point::rotate
+    void rotate(double angleDegrees) {
+        double rad = angleDegrees * PI / 180.0;  // Trig is computed once for all vertices
+        double c = cos(rad), s = sin(rad);
+        size_t n = xs.size(), i = 0;
+        double* x = xs.data();
+        double* y = ys.data();
+#if defined(__AVX2__)
+        const __m256d vc = _mm256_set1_pd(c), vs = _mm256_set1_pd(s);
+        for (; i + 4 <= n; i += 4) {
+            __m256d px = _mm256_loadu_pd(x + i), py = _mm256_loadu_pd(y + i);
+            _mm256_storeu_pd(x + i, _mm256_sub_pd(_mm256_mul_pd(px, vc), _mm256_mul_pd(py, vs)));
+            _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_mul_pd(px, vs), _mm256_mul_pd(py, vc)));
+        }
+#elif defined(__SSE2__)
+        const __m128d vc = _mm_set1_pd(c), vs = _mm_set1_pd(s);
+        for (; i + 2 <= n; i += 2) {
+            __m128d px = _mm_loadu_pd(x + i), py = _mm_loadu_pd(y + i);
+            _mm_storeu_pd(x + i, _mm_sub_pd(_mm_mul_pd(px, vc), _mm_mul_pd(py, vs)));
+            _mm_storeu_pd(y + i, _mm_add_pd(_mm_mul_pd(px, vs), _mm_mul_pd(py, vc)));
+        }
+#endif
+        for (; i < n; i++) {
+            double newX = x[i] * c - y[i] * s;
+            double newY = x[i] * s + y[i] * c;
+            x[i] = newX;
+            y[i] = newY;
+        }
+    }
+
+    // Views: copies of shape i as the original classes, with the current coordinates
+    Line lineAt(size_t shape) const {
+        if (!check(shape, Kind::Line, "line")) return Line(Point(), Point());
+        return Line(vertex(shape, 0), vertex(shape, 1));
+    }
+    Quadrilateral quadrilateralAt(size_t shape) const {
+        if (!check(shape, Kind::Quadrilateral, "quadrilateral")) return Quadrilateral(Point(), Point(), Point(), Point());
+        return Quadrilateral(vertex(shape, 0), vertex(shape, 1), vertex(shape, 2), vertex(shape, 3));
+    }
+    Rectangle rectangleAt(size_t shape) const {
+        if (!check(shape, Kind::Rectangle, "rectangle")) return Rectangle(Point(), Point(), Point(), Point());
+        return Rectangle(vertex(shape, 0), vertex(shape, 1), vertex(shape, 2), vertex(shape, 3));
+    }
+    Square squareAt(size_t shape) const {
+        if (!check(shape, Kind::Square, "square")) return Square(Point(), Point(), Point(), Point());
+        return Square(vertex(shape, 0), vertex(shape, 1), vertex(shape, 2), vertex(shape, 3));
+    }
+    Parallelogram parallelogramAt(size_t shape) const {
+        if (!check(shape, Kind::Parallelogram, "parallelogram")) return Parallelogram(Point(), Point(), Point(), Point());
+        return Parallelogram(vertex(shape, 0), vertex(shape, 1), vertex(shape, 2), vertex(shape, 3));
+    }
+
+    // Shape i rebuilt as the class it was added as; null if there is no shape i
+    std::unique_ptr<Shape> shapeAt(size_t shape) const {
+        if (!inRange(shape)) return nullptr;
+        switch (entries[shape].kind) {
+        case Kind::Line: return std::unique_ptr<Shape>(new Line(lineAt(shape)));
+        case Kind::Square: return std::unique_ptr<Shape>(new Square(squareAt(shape)));
+        case Kind::Rectangle: return std::unique_ptr<Shape>(new Rectangle(rectangleAt(shape)));
+        case Kind::Parallelogram: return std::unique_ptr<Shape>(new Parallelogram(parallelogramAt(shape)));
+        default: return std::unique_ptr<Shape>(new Quadrilateral(quadrilateralAt(shape)));
+        }
+    }
+};
+
+// Value shapes with static dispatch: no virtual functions, no virtual base, vertices
+// stored inline. A homogeneous container holds them as a std::variant and applies
+// batch operations through std::visit, so move/rotate are resolved at compile time
+// and can be inlined.
+namespace value {
+
+// Shared storage and transforms for a polygon with N vertices
+template <int N>
+class Polygon {
+protected:
+    double x[N], y[N];                      // Vertex coordinates
+
+    Polygon() {}
+
+public:
+    static const int vertexCount = N;
+
+    Point vertex(int i) const { return Point(x[i], y[i]); }
+
+    // Move all vertices by dx and dy
+    void move(double dx, double dy) {
+        for (int i = 0; i < N; i++) {
+            x[i] += dx;
+            y[i] += dy;
+        }
+    }
+
+    // Rotate all vertices around origin with precomputed cos and sin of the angle
+    void rotateBy(double cs, double sn) {
+        for (int i = 0; i < N; i++) {
+            double newX = x[i] * cs - y[i] * sn;
+            double newY = x[i] * sn + y[i] * cs;
+            x[i] = newX;
+            y[i] = newY;
+        }
+    }
+
+    // Rotate all vertices around origin by angle degrees
+    void rotate(double angleDegrees) {
+        double rad = angleDegrees * PI / 180.0;
+        rotateBy(cos(rad), sin(rad));
+    }
+};
+
+class Line : public Polygon<2> {
+public:
+    Line(Point a, Point b) {
+        x[0] = a.getX(); y[0] = a.getY();
+        x[1] = b.getX(); y[1] = b.getY();
+    }
+    explicit Line(const usernamespace::Line& l) : Line(l.getA(), l.getB()) {}
+
+    void draw() const {
+        std::cout << "Line from "; vertex(0).draw();
+        std::cout << " to "; vertex(1).draw();
+    }
+};
+
+class Quadrilateral : public Polygon<4> {
+public:
+    Quadrilateral(Point a, Point b, Point c, Point d) {
+        Point p[4] = {a, b, c, d};
+        for (int i = 0; i < 4; i++) {
+            x[i] = p[i].getX();
+            y[i] = p[i].getY();
+        }
+    }
+    explicit Quadrilateral(const usernamespace::Quadrilateral& q)
+        : Quadrilateral(q.getVertex(0), q.getVertex(1), q.getVertex(2), q.getVertex(3)) {}
+
+    void draw() const {
+        std::cout << "Figure with vertices:\n";
+        for (int i = 0; i < 4; i++) vertex(i).draw();
+    }
+};
+
+// Distinct types for the special quadrilaterals, without virtual inheritance
+class Square : public Quadrilateral {
+public:
+    Square(Point origin, double size)
+        : Quadrilateral(origin,
+            Point(origin.getX() + size, origin.getY()),
+            Point(origin.getX() + size, origin.getY() + size),
+            Point(origin.getX(), origin.getY() + size)) {}
+    explicit Square(const usernamespace::Square& q) : Quadrilateral(q) {}
+};
+
+class Rectangle : public Quadrilateral {
+public:
+    Rectangle(Point origin, double width, double height)
+        : Quadrilateral(origin,
+            Point(origin.getX() + width, origin.getY()),
+            Point(origin.getX() + width, origin.getY() + height),
+            Point(origin.getX(), origin.getY() + height)) {}
+    explicit Rectangle(const usernamespace::Rectangle& q) : Quadrilateral(q) {}
+};
+
+class Parallelogram : public Quadrilateral {
+public:
+    Parallelogram(Point origin, double base, double height, double offset)
+        : Quadrilateral(origin,
+            Point(origin.getX() + base, origin.getY()),
+            Point(origin.getX() + base + offset, origin.getY() + height),
+            Point(origin.getX() + offset, origin.getY() + height)) {}
+    explicit Parallelogram(const usernamespace::Parallelogram& q) : Quadrilateral(q) {}
+};
+
+using AnyShape = std::variant<Line, Quadrilateral, Square, Rectangle, Parallelogram>;
+
+// Convert a shape of the virtual hierarchy to the matching value shape
+inline AnyShape fromShape(const Shape& s) {
+    if (auto p = dynamic_cast<const usernamespace::Parallelogram*>(&s)) return Parallelogram(*p);
+    if (auto q = dynamic_cast<const usernamespace::Square*>(&s)) return Square(*q);
+    if (auto r = dynamic_cast<const usernamespace::Rectangle*>(&s)) return Rectangle(*r);
+    if (auto q = dynamic_cast<const usernamespace::Quadrilateral*>(&s)) return Quadrilateral(*q);
+    return Line(dynamic_cast<const usernamespace::Line&>(s));
+}
+
+// Homogeneous container of value shapes with visitor-based batch operations
+class ShapeList {
+private:
+    std::vector<AnyShape> shapes;
+
+public:
+    void reserve(size_t n) { shapes.reserve(n); }
+    void add(const AnyShape& s) { shapes.push_back(s); }
+    size_t size() const { return shapes.size(); }
+    AnyShape& operator[](size_t i) { return shapes[i]; }
+    const AnyShape& operator[](size_t i) const { return shapes[i]; }
+
+    // Call f with each shape as its concrete type
+    template <class F>
+    void forEach(F&& f) {
+        for (AnyShape& s : shapes) std::visit(f, s);
+    }
+    template <class F>
+    void forEach(F&& f) const {
+        for (const AnyShape& s : shapes) std::visit(f, s);
+    }
+
+    void move(double dx, double dy) {
+        forEach([=](auto& s) { s.move(dx, dy); });
+    }
+
+    // Rotate every shape around origin; trig is computed once for the whole list
+    void rotate(double angleDegrees) {
+        double rad = angleDegrees * PI / 180.0;
+        double cs = cos(rad), sn = sin(rad);
+        forEach([=](auto& s) { s.rotateBy(cs, sn); });
+    }
+
+    void draw() const {
+        forEach([](const auto& s) { s.draw(); });
+    }
+};
+
+} // end namespace value
+
+// Bounding volume hierarchy over shapes owned by the caller, for hit-testing
+// (shapes whose box contains a point) and culling (shapes whose box intersects a
+// range) in logarithmic time. After shapes move or rotate, refit() updates the
+// boxes bottom-up in O(n) while keeping the tree; build() again if the shapes
+// have been rearranged so much that the boxes overlap heavily.
+// build() and refit() bake every shape and cache its box; queries only test the
+// cached boxes, never call into the shapes, and can run from several threads at once.
+class ShapeIndex {
+private:
+    struct Node {
+        Box box;
+        int left = -1, right = -1;          // Children of an inner node
+        int first = 0, count = 0;           // Range in order[] of a leaf (count > 0)
+    };
+
+    static const int LEAF_SIZE = 4;
+
+    std::vector<const Shape*> shapes;       // Indexed shapes, in the order passed to build()
+    std::vector<size_t> order;              // Shape indices grouped by leaf
+    std::vector<Box> boxes;                 // Cached box of shape order[k] at position k
+    std::vector<Node> nodes;                // Parents always precede their children
+
+    // Build the subtree over order[first, last) and return its node index
+    int buildNode(size_t first, size_t last, const std::vector<Box>& shapeBoxes) {
+        int id = (int)nodes.size();
+        nodes.push_back(Node());
+        Box box, centers;
+        for (size_t i = first; i < last; i++) {
+            box.expand(shapeBoxes[order[i]]);
+            centers.expand(Point(shapeBoxes[order[i]].centerX(), shapeBoxes[order[i]].centerY()));
+        }
+        nodes[id].box = box;
+        if (last - first <= (size_t)LEAF_SIZE) {
+            nodes[id].first = (int)first;
+            nodes[id].count = (int)(last - first);
+            return id;
+        }
+        // Median split along the wider extent of the box centers
+        bool alongX = centers.maxX - centers.minX >= centers.maxY - centers.minY;
+        size_t mid = first + (last - first) / 2;
+        std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + last,
+            [&](size_t a, size_t b) {
+                return alongX ? shapeBoxes[a].centerX() < shapeBoxes[b].centerX()
+                              : shapeBoxes[a].centerY() < shapeBoxes[b].centerY();
+            });
+        int left = buildNode(first, mid, shapeBoxes);
+        int right = buildNode(mid, last, shapeBoxes);
+        nodes[id].left = left;
+        nodes[id].right = right;
+        return id;
+    }
+
+    // Visit the indices of all shapes whose box passes test
+    template <class Test>
+    std::vector<size_t> query(Test test) const {
+        std::vector<size_t> result;
+        if (nodes.empty()) return result;
+        std::vector<int> stack(1, 0);
+        while (!stack.empty()) {
+            const Node& n = nodes[stack.back()];
+            stack.pop_back();
+            if (!test(n.box)) continue;
+            if (n.count > 0) {
+                for (int i = n.first; i < n.first + n.count; i++)
+                    if (test(boxes[i])) result.push_back(order[i]);
+            } else {
+                stack.push_back(n.right);
+                stack.push_back(n.left);
+            }
+        }
+        return result;
+    }
+
+public:
+    ShapeIndex() {}
+    explicit ShapeIndex(const std::vector<const Shape*>& s) { build(s); }
+
+    // Build the tree over the given shapes; results refer to positions in this vector
+    void build(const std::vector<const Shape*>& s) {
+        shapes = s;
+        order.resize(shapes.size());
+        std::vector<Box> shapeBoxes(shapes.size());
+        for (size_t i = 0; i < shapes.size(); i++) {
+            order[i] = i;
+            shapes[i]->bake();
+            shapeBoxes[i] = shapes[i]->bounds();
+        }
+        nodes.clear();
+        nodes.reserve(2 * shapes.size() / LEAF_SIZE + 1);
+        if (!shapes.empty()) buildNode(0, shapes.size(), shapeBoxes);
+        boxes.resize(shapes.size());
+        for (size_t k = 0; k < order.size(); k++) boxes[k] = shapeBoxes[order[k]];
+    }
+
+    // Recompute all boxes after the shapes moved, keeping the tree structure. Queries
+    // test the boxes cached here, so they do not see changes made after the last refit.
+    void refit() {
+        for (size_t k = 0; k < order.size(); k++) {
+            shapes[order[k]]->bake();
+            boxes[k] = shapes[order[k]]->bounds();
+        }
+        for (size_t i = nodes.size(); i-- > 0;) {
+            Node& n = nodes[i];
+            n.box = Box();
+            if (n.count > 0) {
+                for (int k = n.first; k < n.first + n.count; k++) n.box.expand(boxes[k]);
+            } else {
+                n.box.expand(nodes[n.left].box);
+                n.box.expand(nodes[n.right].box);
+            }
+        }
+    }
+
+    size_t size() const { return shapes.size(); }
+
+    // Indices of shapes whose bounding box contains (x, y)
+    std::vector<size_t> queryPoint(double x, double y) const {
+        return query([=](const Box& b) { return b.contains(x, y); });
+    }
+
+    // Indices of shapes whose bounding box intersects range
+    std::vector<size_t> queryRange(const Box& range) const {
+        return query([&](const Box& b) { return b.intersects(range); });
+    }
+};
+
+// Thread pool for parallel loops over index ranges. A job is cut into chunks that are
+// dealt out in contiguous runs to one queue per thread (the caller included). Each
+// thread takes chunks from the front of its own queue and, once that is empty,
+// steals from the back of the others, so uneven chunks still keep all threads busy.
+class WorkStealingPool {
+private:
+    struct Range { size_t begin, end; };
+    struct Queue {
+        std::mutex lock;
+        std::deque<Range> ranges;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;  // queues[0] belongs to the caller of run()
+    std::mutex jobLock;                     // Serializes callers of run()
+    std::mutex stateLock;                   // Guards the fields below
+    std::condition_variable jobReady;       // Signals workers that a new job started
+    std::condition_variable jobDone;        // Signals the caller that all workers finished
+    const std::function<void(size_t, size_t)>* job = nullptr;  // Range body of the current job
+    int busyWorkers = 0;                    // Workers still inside the current job
+    long long generation = 0;               // Incremented for every job
+    bool stopping = false;
+
+    bool popOwn(int self, Range& r) {
+        Queue& q = *queues[self];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.ranges.empty()) return false;
+        r = q.ranges.front();
+        q.ranges.pop_front();
+        return true;
+    }
+
+    bool steal(int self, Range& r) {
+        int n = (int)queues.size();
+        for (int k = 1; k < n; k++) {
+            Queue& q = *queues[(self + k) % n];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (q.ranges.empty()) continue;
+            r = q.ranges.back();
+            q.ranges.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    // Run chunks of the current job until no queue has any left
+    void drain(int self) {
+        Range r;
+        while (popOwn(self, r) || steal(self, r)) (*job)(r.begin, r.end);
+    }
+
+    void workerLoop(int self) {
+        long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(stateLock);
+                jobReady.wait(guard, [&]() { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            drain(self);
+            std::lock_guard<std::mutex> guard(stateLock);
+            if (--busyWorkers == 0) jobDone.notify_one();
+        }
+    }
+
+public:
+    explicit WorkStealingPool(int threads) {
+        threads = std::max(1, threads);
+        for (int i = 0; i < threads; i++) queues.emplace_back(new Queue());
+        for (int i = 1; i < threads; i++) workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    // Threads working on a job, the caller included
+    int size() const { return (int)queues.size(); }
+
+    // Call body(begin, end) on chunks of at most chunk indices covering [0, n) exactly
+    // once, spread over the pool, and wait for all of them
+    void run(size_t n, size_t chunk, const std::function<void(size_t, size_t)>& body) {
+        chunk = std::max<size_t>(1, chunk);
+        size_t chunks = (n + chunk - 1) / chunk;
+        if (workers.empty() || chunks <= 1) {
+            if (n > 0) body(0, n);
+            return;
+        }
+        std::lock_guard<std::mutex> callGuard(jobLock);
+        size_t threads = queues.size();
+        for (size_t t = 0; t < threads; t++) {
+            std::lock_guard<std::mutex> guard(queues[t]->lock);
+            for (size_t c = chunks * t / threads; c < chunks * (t + 1) / threads; c++)
+                queues[t]->ranges.push_back({c * chunk, std::min(n, (c + 1) * chunk)});
+        }
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            job = &body;
+            busyWorkers = (int)workers.size();
+            generation++;
+        }
+        jobReady.notify_all();
+        drain(0);
+        std::unique_lock<std::mutex> guard(stateLock);
+        jobDone.wait(guard, [&]() { return busyWorkers == 0; });
+        job = nullptr;
+    }
+};
+
+// Owning container of shapes whose bulk operations run on a WorkStealingPool. Each
+// shape is touched by exactly one thread per call and shapes do not share state, so
+// the result does not depend on the thread count or on which thread stole what.
+class Scene {
+private:
+    std::vector<std::unique_ptr<Shape>> shapes;
+    std::unique_ptr<WorkStealingPool> pool;
+    size_t chunkSize = 1024;                // Shapes per scheduled chunk
+
+public:
+    explicit Scene(int threads = std::max(1, (int)std::thread::hardware_concurrency()))
+        : pool(new WorkStealingPool(threads)) {}
+
+    void reserve(size_t n) { shapes.reserve(n); }
+    void add(std::unique_ptr<Shape> s) { shapes.push_back(std::move(s)); }
+    size_t size() const { return shapes.size(); }
+    Shape& operator[](size_t i) { return *shapes[i]; }
+    const Shape& operator[](size_t i) const { return *shapes[i]; }
+
+    int threads() const { return pool->size(); }
+    void setThreads(int threads) {
+        pool.reset();
+        pool.reset(new WorkStealingPool(threads));
+    }
+    void setChunkSize(size_t n) { chunkSize = std::max<size_t>(1, n); }
+
+    // Non-owning view of the shapes, e.g. for ShapeIndex
+    std::vector<const Shape*> view() const {
+        std::vector<const Shape*> v;
+        v.reserve(shapes.size());
+        for (const auto& s : shapes) v.push_back(s.get());
+        return v;
+    }
+
+    // Call f(shape) for every shape in parallel; f must only modify the shape it gets
+    template <class F>
+    void forEachShape(F f) {
+        pool->run(shapes.size(), chunkSize, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) f(*shapes[i]);
+        });
+    }
+
+    // Apply m to every shape and bake the result into the vertices in parallel
+    void transformAll(const Affine& m) {
+        forEachShape([&](Shape& s) {
+            s.transform(m);
+            s.bake();
+        });
+    }
+
+    void moveAll(double dx, double dy) {
+        Affine m;
+        m.translate(dx, dy);
+        transformAll(m);
+    }
+
+    void rotateAll(double angleDegrees) {
+        Affine m;
+        m.rotate(angleDegrees);
+        transformAll(m);
+    }
 };
 
 } // end namespace usernamespace
 
 
-int main() {
+// Compare per-shape virtual move/rotate with ShapeBatch on the same shapes.
+// Prints one CSV line per approach and checks that both end at the same vertices.
+static int benchBatch(size_t shapes) {
+    using namespace usernamespace;
+    const int steps = 10;
+    std::vector<std::unique_ptr<Shape>> objects;
+    ShapeBatch batch;
+    objects.reserve(shapes);
+    batch.reserve(shapes, shapes * 4);
+    for (size_t i = 0; i < shapes; i++) {
+        double o = (double)(i % 1000) * 0.01;
+        switch (i % 4) {
+        case 0: { Line s(Point(o, -o), Point(o + 1, o)); batch.add(s); objects.emplace_back(new Line(s)); break; }
+        case 1: { Square s(Point(o, o), 2); batch.add(s); objects.emplace_back(new Square(s)); break; }
+        case 2: { Rectangle s(Point(-o, o), 3, 1); batch.add(s); objects.emplace_back(new Rectangle(s)); break; }
+        default: { Parallelogram s(Point(o, 0), 2, 1, 0.5); batch.add(s); objects.emplace_back(new Parallelogram(s)); break; }
+        }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < steps; k++) {
+        for (auto& s : objects) {
+            s->move(0.5, -0.25);
+            s->rotate(3);
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int k = 0; k < steps; k++) {
+        batch.move(0.5, -0.25);
+        batch.rotate(3);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    // Both paths use the same formula, so results only differ by rounding of the trig calls
+    double maxDiff = 0;
+    for (size_t i = 0; i < shapes; i++) {
+        Point a[4], b[4];
+        int n = 0;
+        if (const Line* l = dynamic_cast<const Line*>(objects[i].get())) {
+            Line v = batch.lineAt(i);
+            a[0] = l->getA(); a[1] = l->getB(); b[0] = v.getA(); b[1] = v.getB(); n = 2;
+        } else if (const Quadrilateral* q = dynamic_cast<const Quadrilateral*>(objects[i].get())) {
+            Quadrilateral v = batch.quadrilateralAt(i);
+            for (n = 0; n < 4; n++) { a[n] = q->getVertex(n); b[n] = v.getVertex(n); }
+        }
+        for (int j = 0; j < n; j++) {
+            maxDiff = std::max(maxDiff, std::fabs(a[j].getX() - b[j].getX()));
+            maxDiff = std::max(maxDiff, std::fabs(a[j].getY() - b[j].getY()));
+        }
+    }
+
+    double virt = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double soa = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    std::cout << "approach,shapes,steps,ms\n";
+    std::cout << "virtual," << shapes << "," << steps << "," << virt << "\n";
+    std::cout << "batch," << shapes << "," << steps << "," << soa << "\n";
+    std::cout << "speedup " << virt / soa << "x, max difference " << maxDiff << "\n";
+    if (maxDiff > 1e-9) {
+        std::cerr << "Error: batch result differs from per-shape result\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Compare the virtual hierarchy with value::ShapeList on the same shapes: a number
+// of move/rotate steps followed by reading every vertex back.
+static int benchVariant(size_t shapes) {
+    using namespace usernamespace;
+    const int steps = 10;
+    std::vector<std::unique_ptr<Shape>> objects;
+    value::ShapeList list;
+    objects.reserve(shapes);
+    list.reserve(shapes);
+    for (size_t i = 0; i < shapes; i++) {
+        double o = (double)(i % 1000) * 0.01;
+        switch (i % 4) {
+        case 0: objects.emplace_back(new Line(Point(o, -o), Point(o + 1, o))); break;
+        case 1: objects.emplace_back(new Square(Point(o, o), 2)); break;
+        case 2: objects.emplace_back(new Rectangle(Point(-o, o), 3, 1)); break;
+        default: objects.emplace_back(new Parallelogram(Point(o, 0), 2, 1, 0.5)); break;
+        }
+        list.add(value::fromShape(*objects.back()));
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    double virtSum = 0;
+    for (int k = 0; k < steps; k++) {
+        for (auto& s : objects) {
+            s->move(0.5, -0.25);
+            s->rotate(3);
+        }
+    }
+    for (auto& s : objects) {
+        if (const Line* l = dynamic_cast<const Line*>(s.get()))
+            virtSum += l->getA().getX() + l->getB().getX();
+        else if (const Quadrilateral* q = dynamic_cast<const Quadrilateral*>(s.get()))
+            for (int j = 0; j < 4; j++) virtSum += q->getVertex(j).getX();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double valueSum = 0;
+    for (int k = 0; k < steps; k++) {
+        list.move(0.5, -0.25);
+        list.rotate(3);
+    }
+    list.forEach([&](const auto& s) {
+        for (int j = 0; j < s.vertexCount; j++) valueSum += s.vertex(j).getX();
+    });
+    auto t2 = std::chrono::steady_clock::now();
+
+    double virt = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double stat = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    std::cout << "approach,shapes,steps,ms\n";
+    std::cout << "virtual," << shapes << "," << steps << "," << virt << "\n";
+    std::cout << "variant," << shapes << "," << steps << "," << stat << "\n";
+    std::cout << "speedup " << virt / stat << "x, checksum difference " << std::fabs(virtSum - valueSum) << "\n";
+    if (std::fabs(virtSum - valueSum) > 1e-6 * (1 + std::fabs(virtSum))) {
+        std::cerr << "Error: variant result differs from virtual result\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Build a ShapeIndex over scattered shapes, time point and range queries against
+// testing every shape, then move and rotate everything, refit and check again.
+static int benchIndex(size_t shapes) {
+    using namespace usernamespace;
+    const int queries = 200;
+    std::vector<std::unique_ptr<Shape>> objects;
+    std::vector<const Shape*> view;
+    objects.reserve(shapes);
+    unsigned long long seed = 12345;
+    auto next = [&seed]() {                 // Deterministic LCG in [0, 1)
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (double)(seed >> 11) / 9007199254740992.0;
+    };
+    const double world = 1000;
+    for (size_t i = 0; i < shapes; i++) {
+        Point o(next() * world, next() * world);
+        if (i % 2) objects.emplace_back(new Rectangle(o, 1 + next(), 1 + next()));
+        else objects.emplace_back(new Line(o, Point(o.getX() + next() * 2, o.getY() + next() * 2)));
+        view.push_back(objects.back().get());
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    ShapeIndex index(view);
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "build " << shapes << " shapes: "
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+
+    std::vector<double> px(queries), py(queries);
+    std::vector<Box> ranges(queries);
+    int errors = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int q = 0; q < queries; q++) {
+            px[q] = next() * world; py[q] = next() * world;
+            double x = next() * world, y = next() * world;
+            ranges[q] = Box(x, y, x + 5, y + 5);
+        }
+
+        size_t found = 0;
+        std::vector<Box> boxes(shapes);     // Brute force tests precomputed boxes
+        for (size_t i = 0; i < shapes; i++) boxes[i] = view[i]->bounds();
+        auto q0 = std::chrono::steady_clock::now();
+        std::vector<std::vector<size_t>> indexed(2 * queries);
+        for (int q = 0; q < queries; q++) {
+            indexed[q] = index.queryPoint(px[q], py[q]);
+            indexed[queries + q] = index.queryRange(ranges[q]);
+        }
+        auto q1 = std::chrono::steady_clock::now();
+        std::vector<std::vector<size_t>> brute(2 * queries);
+        for (int q = 0; q < queries; q++) {
+            for (size_t i = 0; i < shapes; i++) {
+                if (boxes[i].contains(px[q], py[q])) brute[q].push_back(i);
+                if (boxes[i].intersects(ranges[q])) brute[queries + q].push_back(i);
+            }
+        }
+        auto q2 = std::chrono::steady_clock::now();
+        for (int q = 0; q < 2 * queries; q++) {
+            std::sort(indexed[q].begin(), indexed[q].end());
+            if (indexed[q] != brute[q]) errors++;
+            found += indexed[q].size();
+        }
+        double ti = std::chrono::duration<double, std::milli>(q1 - q0).count();
+        double tb = std::chrono::duration<double, std::milli>(q2 - q1).count();
+        std::cout << (pass ? "after refit: " : "") << 2 * queries << " point+range queries, " << found
+                  << " hits: index " << ti << " ms, brute force " << tb << " ms, speedup " << tb / ti << "x\n";
+
+        if (pass == 0) {
+            for (auto& s : objects) {
+                s->move(3, -2);
+                s->rotate(0.5);
+            }
+            auto r0 = std::chrono::steady_clock::now();
+            index.refit();
+            auto r1 = std::chrono::steady_clock::now();
+            std::cout << "refit after move+rotate: " << std::chrono::duration<double, std::milli>(r1 - r0).count() << " ms\n";
+        }
+    }
+    if (errors) {
+        std::cerr << "Error: " << errors << " index queries differ from brute force\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Time Scene::transformAll for 1, 2, 4 ... maxThreads threads on the same scene and
+// check that every thread count produces bit-identical vertices.
+static int benchScene(size_t shapes, int maxThreads) {
+    using namespace usernamespace;
+    const int steps = 10;
+    Affine step;                            // Small move followed by a small rotation
+    step.translate(0.5, -0.25);
+    step.rotate(3);
+
+    std::cout << "threads,shapes,steps,ms,shapes_per_s,speedup\n";
+    std::vector<int> counts;                // Powers of two below maxThreads, then maxThreads
+    for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(std::max(1, maxThreads));
+
+    double base = 0, reference = 0;
+    for (int threads : counts) {
+        Scene scene(threads);
+        scene.reserve(shapes);
+        for (size_t i = 0; i < shapes; i++) {
+            double o = (double)(i % 1000) * 0.01;
+            if (i % 2) scene.add(std::unique_ptr<Shape>(new Rectangle(Point(-o, o), 3, 1)));
+            else scene.add(std::unique_ptr<Shape>(new Line(Point(o, -o), Point(o + 1, o))));
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < steps; k++) scene.transformAll(step);
+        auto t1 = std::chrono::steady_clock::now();
+
+        double sum = 0;
+        for (size_t i = 0; i < scene.size(); i++) {
+            Box b = scene[i].bounds();
+            sum += b.minX + 3 * b.maxY;
+        }
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        if (threads == 1) { base = ms; reference = sum; }
+        std::cout << threads << "," << shapes << "," << steps << "," << ms << ","
+                  << shapes * steps / (ms / 1000) << "," << base / ms << "\n";
+        if (sum != reference) {
+            std::cerr << "Error: result with " << threads << " threads differs from 1 thread\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
     setlocale(LC_ALL,"RU"); // Set locale for Russian output (not essential for logic)
 
+    // Benchmark mode: programmingLab3 bench-batch [shapes]
+    if (argc > 1 && std::string(argv[1]) == "bench-batch")
+        return benchBatch(argc > 2 ? std::stoul(argv[2]) : 1000000);
+    // Benchmark mode: programmingLab3 bench-variant [shapes]
+    if (argc > 1 && std::string(argv[1]) == "bench-variant")
+        return benchVariant(argc > 2 ? std::stoul(argv[2]) : 1000000);
+    // Benchmark mode: programmingLab3 bench-index [shapes]
+    if (argc > 1 && std::string(argv[1]) == "bench-index")
+        return benchIndex(argc > 2 ? std::stoul(argv[2]) : 1000000);
+    // Benchmark mode: programmingLab3 bench-scene [shapes] [max threads]
+    if (argc > 1 && std::string(argv[1]) == "bench-scene")
+        return benchScene(argc > 2 ? std::stoul(argv[2]) : 1000000,
+                          argc > 3 ? std::stoi(argv[3]) : std::max(1, (int)std::thread::hardware_concurrency()));
+
     // Create a line using Point class within usernamespace
     usernamespace::Line l(usernamespace::Point(0, 0), usernamespace::Point(2, 2));
     l.draw();                      // Draw the line